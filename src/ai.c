@@ -1,16 +1,88 @@
+# include <sched.h>
 # include "ai.h"
 
-// creates an ai 
+// rounds a search thread runs between looks at the clock
+# define CLOCK_ROUNDS 64
+
+// seconds the time manager waits between looks at a running search
+# define MANAGER_INTERVAL 0.005
+
+// share of a move's time the endgame solver may use before the tree search
+// takes over
+# define SOLVE_SHARE 0.75
+
+// positions the endgame solver may search per playout or node of a move's
+// budget before the tree search takes over
+# define SOLVE_NODES 64
+
+// arguments of a search thread
+// ai -> the ai running the search
+// tr -> the tree the thread grows
+// r -> the thread's random number generator
+// rounds -> rounds the thread may still run, UINT64_MAX without a playout
+//           budget
+// nodes -> node count of the tree at which the thread stops, or 0 without a
+//          node budget
+typedef struct worker
+{
+    AI *ai;
+    tree *tr;
+    rng *r;
+    uint64_t rounds;
+    uint64_t nodes;
+} worker;
+
+// creates an ai
 // b -> the current game state
+// cfg -> the settings for the ai
 // returns -> a pointer to an ai struct
-AI *createAI(board *b, int seconds)
+AI *createAI(board *b, config *cfg)
 {
     AI *ai = (AI *) malloc(sizeof(AI));
-    ai->tree = createTree(b);
-    ai->seconds = (double) seconds;
+    ai->cfg = *cfg;
+    ai->seconds = (double) cfg->seconds;
     ai->time_spent = 0;
+    ai->reclaimer = cfg->reclaimer ? cfg->reclaimer : createReclaimer();
+    ai->reclaimed = 0;
+    ai->reclaim_time = 0;
+    ai->playouts = 0;
+    ai->search_time = 0;
+    ai->deadline = 0;
+    ai->stop = 0;
+    ai->running = 0;
+    ai->ponder_playouts = 0;
+    ai->ponder_start = 0;
+    ai->solution.nodes = 0;
+    ai->opening.games = 0;
+    ai->ids = (pthread_t *) malloc(sizeof(pthread_t) * cfg->threads);
+    ai->workers = (worker *) malloc(sizeof(worker) * cfg->threads);
+
+    // every thread gets its own random stream
+    uint64_t seed = cfg->seed ? cfg->seed : (uint64_t) time(NULL);
+    ai->rngs = (rng *) malloc(sizeof(rng) * cfg->threads);
+    for (int i = 0; i < cfg->threads; i++)
+    {
+        seedRandom(&ai->rngs[i], seed + i);
+    }
+
+    ai->tree_count = cfg->shared ? 1 : cfg->threads;
+    ai->trees = (tree **) malloc(sizeof(tree *) * ai->tree_count);
+    for (int i = 0; i < ai->tree_count; i++)
+    {
+        ai->trees[i] = createTree(b);
+        ai->trees[i]->limit = cfg->memory / ai->tree_count;
+    }
+
+    // resume from the statistics of earlier runs if they searched this
+    // position, the snapshot being the first tree's, so that the other trees
+    // of a root parallel search stay independent
+    ai->loaded = 0;
+    ai->saved = 0;
+    if (cfg->snapshot && loadTree(ai->trees[0], cfg->snapshot) == 0)
+    {
+        ai->loaded = ai->trees[0]->plays;
+    }
 
-    srand(time(NULL));
     return ai;
 }
 
@@ -18,52 +90,472 @@ AI *createAI(board *b, int seconds)
 // ai -> the ai that is becoming sentient
 void destroyAI(AI *ai)
 {
-    deleteTree(ai->tree);
+    stopPonder(ai);
+
+    // subtrees still queued go with their trees' arenas, but a shared
+    // reclaimer outlives the trees, so it is drained first
+    if (ai->cfg.reclaimer)
+    {
+        waitReclaimer(ai->reclaimer);
+    }
+    else
+    {
+        deleteReclaimer(ai->reclaimer);
+    }
+    for (int i = 0; i < ai->tree_count; i++)
+    {
+        deleteTree(ai->trees[i]);
+    }
+
+    free(ai->trees);
+    free(ai->rngs);
+    free(ai->ids);
+    free(ai->workers);
     free(ai);
 }
 
+// relative share of the clock given to a move
+// the opening positions are well known and the last moves are few and quick,
+// so most of the time goes to the midgame, where games are decided
+// empties -> the number of empty squares before the move
+// returns -> the weight of the move
+static double phaseWeight(int empties)
+{
+    if (empties > 48)
+    {
+        return 0.6;
+    }
+    if (empties > 20)
+    {
+        return 1.4;
+    }
+    return 0.8;
+}
+
 // determine the amount of time available for the next move
+// the remaining time is split over the ai's remaining moves by phase weight,
+// so time saved by stopping early is spread over the later moves
 // ai -> the ai to use for the calculation
 // returns -> the amount of time in seconds
 double getTime(AI *ai)
 {
-    int black = __builtin_popcountll(ai->tree->root->b->pieces[0]);
-    int white = __builtin_popcountll(ai->tree->root->b->pieces[1]);
+    board *b = &ai->trees[0]->root.b;
+    int empties = 64 - __builtin_popcountll(b->pieces[0] | b->pieces[1]);
+    double remaining = ai->seconds - ai->time_spent;
 
-    int moves_left = (64 - black - white) / 2 + 1;
+    if (empties <= 0 || remaining <= 0)
+    {
+        return 0;
+    }
 
-    return (ai->seconds - ai->time_spent) / (double)(moves_left);
+    // the ai moves on every other empty square from here on, and one extra
+    // move's share stays in reserve so the clock never runs out
+    double total = 1;
+    for (int e = empties; e > 0; e -= 2)
+    {
+        total += phaseWeight(e);
+    }
+
+    return remaining * phaseWeight(empties) / total;
 }
 
-// figures out the "best" move to make
+// checks whether a thread has used up its share of the move's budget
+// w -> the thread
+// returns -> 1 if the thread is done
+static int workerDone(worker *w)
+{
+    return !w->rounds || (w->nodes && __atomic_load_n(&w->tr->nodes, __ATOMIC_RELAXED) >= w->nodes);
+}
+
+// runs a batch of rounds on a thread's tree, first pruning it if it is over
+// its memory cap, and stopping early if the search is stopped or the thread
+// uses up its budget
+// w -> the thread
+// rounds -> the number of rounds
+static void searchRounds(worker *w, int rounds)
+{
+    AI *ai = w->ai;
+    tree *tr = w->tr;
+
+    // over the memory cap, wait for the other threads' rounds to end and
+    // prune, unless another thread is already pruning
+    int expected = 0;
+    if (tr->limit && treeMemory(tr) > tr->limit
+        && __atomic_compare_exchange_n(&tr->pruning, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        pthread_rwlock_wrlock(&tr->rounds);
+        pruneTree(tr);
+        pthread_rwlock_unlock(&tr->rounds);
+        __atomic_store_n(&tr->pruning, 0, __ATOMIC_RELEASE);
+    }
+
+    // let a waiting pruner take the tree before starting more rounds
+    while (__atomic_load_n(&tr->pruning, __ATOMIC_ACQUIRE))
+    {
+        sched_yield();
+    }
+
+    pthread_rwlock_rdlock(&tr->rounds);
+    uint64_t nodes = __atomic_load_n(&tr->nodes, __ATOMIC_RELAXED);
+    int i;
+    for (i = 0; i < rounds && !__atomic_load_n(&ai->stop, __ATOMIC_RELAXED) && !workerDone(w); i++)
+    {
+        doRound(tr, w->r);
+        w->rounds--;
+    }
+    pthread_rwlock_unlock(&tr->rounds);
+
+    // a whole batch that adds no node has reached the end of every line, so
+    // a node budget larger than the tree that is left can never be used up
+    if (w->nodes && i == rounds && __atomic_load_n(&tr->nodes, __ATOMIC_RELAXED) == nodes)
+    {
+        w->rounds = 0;
+    }
+}
+
+// runs rounds on a tree until the search deadline or until stopped
+// the clock is only read every CLOCK_ROUNDS rounds
+// arg -> the worker describing the thread's tree
+// returns -> NULL
+static void *searchTree(void *arg)
+{
+    worker *w = (worker *) arg;
+
+    while (!__atomic_load_n(&w->ai->stop, __ATOMIC_RELAXED) && getClock() < w->ai->deadline && !workerDone(w))
+    {
+        searchRounds(w, CLOCK_ROUNDS);
+    }
+
+    flushStats();
+    return NULL;
+}
+
+// checks whether moves are searched within a budget instead of on the clock
+// ai -> the ai
+// returns -> 1 if the ai has a playout or node budget
+static int hasBudget(AI *ai)
+{
+    return ai->cfg.playouts || ai->cfg.nodes;
+}
+
+// hands each search thread its tree and its share of the move's budget
+// the playouts are split over the threads and the nodes over the trees, so
+// that each tree of a root parallel search grows the same way on every run
+// ai -> the ai to search with
+// budgeted -> whether to split the budget, or let the threads run until
+//             stopped
+static void setupWorkers(AI *ai, int budgeted)
+{
+    int threads = ai->cfg.threads;
+    int trees = ai->tree_count;
+    for (int i = 0; i < threads; i++)
+    {
+        worker *w = &ai->workers[i];
+        w->ai = ai;
+        w->tr = ai->trees[i % trees];
+        w->r = &ai->rngs[i];
+        w->rounds = UINT64_MAX;
+        w->nodes = 0;
+
+        if (budgeted && ai->cfg.playouts)
+        {
+            w->rounds = ai->cfg.playouts / threads + (i < (int) (ai->cfg.playouts % threads));
+        }
+        if (budgeted && ai->cfg.nodes)
+        {
+            int t = i % trees;
+            w->nodes = w->tr->nodes + ai->cfg.nodes / trees + (t < (int) (ai->cfg.nodes % trees));
+        }
+    }
+}
+
+// starts the search threads
+// ai -> the ai to search with, its workers set up
+// deadline -> wall clock time at which the threads stop by themselves
+static void startSearch(AI *ai, double deadline)
+{
+    ai->deadline = deadline;
+    ai->stop = 0;
+    ai->running = 1;
+
+    for (int i = 0; i < ai->cfg.threads; i++)
+    {
+        pthread_create(&ai->ids[i], NULL, searchTree, &ai->workers[i]);
+    }
+}
+
+// waits for the search threads to finish
+// ai -> the ai that is searching
+static void joinSearch(AI *ai)
+{
+    for (int i = 0; i < ai->cfg.threads; i++)
+    {
+        pthread_join(ai->ids[i], NULL);
+    }
+
+    ai->running = 0;
+}
+
+// checks whether the most played move can no longer be overtaken by the
+// playouts that fit in the time left of the running search
+// ai -> the ai that is searching
+// s -> the current root statistics
+// returns -> 1 if the search can stop
+static int moveDecided(AI *ai, summary *s)
+{
+    uint32_t best = 0;
+    uint32_t second = 0;
+    for (int i = 0; i <= PASS; i++)
+    {
+        if (s->plays[i] > best)
+        {
+            second = best;
+            best = s->plays[i];
+        }
+        else if (s->plays[i] > second)
+        {
+            second = s->plays[i];
+        }
+    }
+
+    double now = getClock();
+    double rate = (s->total_plays - ai->start_plays) / (now - ai->start_time);
+    return best - second > rate * (ai->deadline - now);
+}
+
+// starts working out the next move, settling it at once when there is a
+// single move, a book move or an endgame solution, and otherwise setting the
+// deadline of the tree search
 // ai -> the ai to use for the calculation
-// returns -> a bitboard with a single bit set as the move
-bitboard calcBestMove(AI *ai)
+// start -> wall clock time the move was asked for, from which its time is
+//          charged, even if the search starts later
+// move -> filled with the move if it was settled
+// returns -> 1 if the move was settled, 0 if it needs a tree search
+int beginMove(AI *ai, double start, bitboard *move)
 {
-    clock_t start_time = clock();
+    // under a budget the subtrees discarded by the last moves are released
+    // first, so that no search shares one of their blocks on some runs only
+    if (hasBudget(ai))
+    {
+        waitReclaimer(ai->reclaimer);
+    }
+
+    ai->start_time = start;
     double time_free = getTime(ai);
 
-    while ((clock() - start_time) < time_free * CLOCKS_PER_SEC)
+    // memory released by re-rooting since the previous search, the
+    // reclaimer possibly still releasing some of it
+    ai->reclaimed = 0;
+    for (int i = 0; i < ai->tree_count; i++)
+    {
+        tree *tr = ai->trees[i];
+        pthread_mutex_lock(&tr->lock);
+        ai->reclaimed += tr->arena->reclaimed;
+        arenaMark(tr->arena);
+        pthread_mutex_unlock(&tr->lock);
+    }
+    ai->reclaim_time = takeReclaimTime(ai->reclaimer);
+
+    summary before;
+    summarizeAI(ai, &before);
+    ai->start_plays = before.total_plays;
+    resetStats();
+
+    // with a single move, or moves that are all symmetric copies of one, there
+    // is nothing to decide, unless the search grows the snapshot's tree
+    board *b = &ai->trees[0]->root.b;
+    ai->solution.nodes = 0;
+    ai->opening.games = 0;
+    ai->playouts = 0;
+    ai->search_time = 0;
+    bitboard distinct = childMoves(b);
+    int keeping = ai->cfg.snapshot && !ai->saved;
+    if (__builtin_popcountll(b->moves) <= 1 || (__builtin_popcountll(distinct) <= 1 && !keeping))
+    {
+        *move = __builtin_popcountll(b->moves) <= 1 ? b->moves : distinct;
+        ai->time_spent += getClock() - ai->start_time;
+        return 1;
+    }
+
+    // known openings are played without searching
+    if (ai->cfg.book)
+    {
+        *move = findBookMove(ai->cfg.book, b, &ai->opening);
+        if (*move)
+        {
+            ai->time_spent += getClock() - ai->start_time;
+            return 1;
+        }
+    }
+
+    // close to the end, play perfectly if the solver finishes in time
+    int empties = 64 - __builtin_popcountll(b->pieces[0] | b->pieces[1]);
+    if (empties <= ai->cfg.endgame)
+    {
+        // under a budget the solver gives up after a number of positions
+        // instead of at a time, which ends it at the same point on every run
+        uint64_t budget = ai->cfg.playouts && (!ai->cfg.nodes || ai->cfg.playouts < ai->cfg.nodes) ? ai->cfg.playouts : ai->cfg.nodes;
+        double deadline = hasBudget(ai) ? INFINITY : ai->start_time + time_free * SOLVE_SHARE;
+        solveBoard(b, deadline, budget * SOLVE_NODES, &ai->solution);
+        if (ai->solution.solved)
+        {
+            ai->search_time = getClock() - ai->start_time;
+            ai->time_spent += ai->search_time;
+            *move = ai->solution.move;
+            return 1;
+        }
+    }
+
+    ai->deadline = hasBudget(ai) ? INFINITY : ai->start_time + time_free;
+    ai->stop = 0;
+    setupWorkers(ai, hasBudget(ai));
+    return 0;
+}
+
+// runs a slice of the tree search started by beginMove on the calling
+// thread, a batch of rounds for each search thread, for callers that share their
+// threads between many searches
+// ai -> the ai that is searching
+// rounds -> the number of rounds run by each thread
+// returns -> 1 once the deadline has passed or the move is decided, or once
+//            the budget is used up
+int stepMove(AI *ai, int rounds)
+{
+    // a slice that waited past the deadline only ends the search
+    int done = 1;
+    for (int i = 0; i < ai->cfg.threads && getClock() < ai->deadline; i++)
     {
-        doRound(ai->tree);
+        searchRounds(&ai->workers[i], rounds);
+        done &= workerDone(&ai->workers[i]);
     }
 
-    ai->time_spent += time_free;
+    // a budget is always used up, the move being decided early or not
+    if (hasBudget(ai))
+    {
+        return done;
+    }
+
+    summary s;
+    summarizeAI(ai, &s);
+    return getClock() >= ai->deadline || moveDecided(ai, &s);
+}
+
+// ends the tree search started by beginMove, picking the most played move
+// ai -> the ai that searched
+// returns -> a bitboard with a single bit set as the move
+bitboard endMove(AI *ai)
+{
+    summary s;
+    summarizeAI(ai, &s);
+
+    // every round ends in exactly one playout
+    ai->playouts = s.total_plays - ai->start_plays;
+    ai->search_time = getClock() - ai->start_time;
+    ai->time_spent += ai->search_time;
 
     // get move with highest number of plays
-    bitboard best_move = 0x0; 
-    int best_score;
-    for (int i = 0; i < ai->tree->root->node_count; i++)
+    int best_move = -1;
+    for (int i = 0; i <= PASS; i++)
+    {
+        if (s.plays[i] && (best_move == -1 || s.plays[i] > s.plays[best_move]))
+        {
+            best_move = i;
+        }
+    }
+
+    // nothing was searched, so fall back to any legal move
+    if (best_move == -1)
+    {
+        bitboard moves = ai->trees[0]->root.b.moves;
+        return moves & -moves;
+    }
+
+    return moveBit(best_move);
+}
+
+// figures out the "best" move to make
+// the threads either search their own trees from the same root, whose root
+// statistics are merged before picking a move, or all search one tree
+// ai -> the ai to use for the calculation
+// returns -> a bitboard with a single bit set as the move
+bitboard calcBestMove(AI *ai)
+{
+    bitboard move;
+    if (beginMove(ai, getClock(), &move))
     {
-        int score = ai->tree->root->next[i]->plays;
-        if (!best_move || score > best_score)
+        return move;
+    }
+
+    startSearch(ai, ai->deadline);
+
+    // time manager: stop as soon as the most played move can no longer be
+    // overtaken by the playouts that fit in the time left, while a budget is
+    // always used up
+    summary s;
+    while (!hasBudget(ai) && getClock() < ai->deadline)
+    {
+        struct timespec wait = { 0, (long) (MANAGER_INTERVAL * 1e9) };
+        nanosleep(&wait, NULL);
+
+        summarizeAI(ai, &s);
+        if (moveDecided(ai, &s))
         {
-            best_move = ai->tree->root->next[i]->move;
-            best_score = score;
+            __atomic_store_n(&ai->stop, 1, __ATOMIC_RELAXED);
+            break;
         }
     }
 
-    return best_move;
+    joinSearch(ai);
+
+    return endMove(ai);
+}
+
+// keeps searching the current tree in the background while the opponent
+// thinks, until stopPonder is called
+// ai -> the ai to ponder with
+void startPonder(AI *ai)
+{
+    if (ai->running)
+    {
+        return;
+    }
+
+    summary s;
+    summarizeAI(ai, &s);
+    ai->ponder_start = s.total_plays;
+
+    setupWorkers(ai, 0);
+    startSearch(ai, INFINITY);
+}
+
+// stops pondering, leaving the tree ready to be re-rooted
+// ai -> the ai to stop
+void stopPonder(AI *ai)
+{
+    if (!ai->running)
+    {
+        return;
+    }
+
+    __atomic_store_n(&ai->stop, 1, __ATOMIC_RELAXED);
+    joinSearch(ai);
+
+    summary s;
+    summarizeAI(ai, &s);
+    ai->ponder_playouts = s.total_plays - ai->ponder_start;
+}
+
+// saves the first tree to the snapshot file while it is still rooted at the
+// starting position, once per ai, to be called while the opponent thinks so
+// that the save does not delay a reply
+// ai -> the ai, not searching
+void saveAI(AI *ai)
+{
+    if (ai->cfg.snapshot && !ai->saved)
+    {
+        saveTree(ai->trees[0], ai->cfg.snapshot);
+        ai->saved = 1;
+    }
 }
 
 // informs ai of a new move that has been played
@@ -71,41 +563,149 @@ bitboard calcBestMove(AI *ai)
 // move -> the move that was just made
 void updateAI(AI *ai, bitboard move)
 {
-    updateTree(ai->tree, move);
+    // keep the tree of the starting position for the next run, charging the
+    // save to the clock when it could not be done on the opponent's time
+    if (ai->cfg.snapshot && !ai->saved)
+    {
+        double start = getClock();
+        saveAI(ai);
+        ai->time_spent += getClock() - start;
+    }
+
+    // the discarded subtrees are released while the next search runs
+    for (int i = 0; i < ai->tree_count; i++)
+    {
+        block *bl = updateTree(ai->trees[i], move);
+        if (bl)
+        {
+            reclaimBlock(ai->reclaimer, ai->trees[i], bl);
+        }
+    }
+}
+
+// combines the root statistics of every tree
+// ai -> the ai to summarize
+// s -> filled with the combined statistics
+void summarizeAI(AI *ai, summary *s)
+{
+    memset(s, 0, sizeof(summary));
+
+    for (int i = 0; i < ai->tree_count; i++)
+    {
+        // the search may still be running, so the statistics are read
+        // atomically and the root may be in the middle of its expansion
+        tree *tr = ai->trees[i];
+        s->total_wins += __atomic_load_n(&tr->wins, __ATOMIC_RELAXED);
+        s->total_plays += __atomic_load_n(&tr->plays, __ATOMIC_RELAXED);
+
+        // a child is only set up once its first play is published
+        block *bl = __atomic_load_n(&tr->root.next, __ATOMIC_ACQUIRE);
+        int child_count = bl && bl != EXPANDING ? __atomic_load_n(&bl->child_count, __ATOMIC_RELAXED) : 0;
+        for (int j = 0; j < child_count; j++)
+        {
+            uint32_t plays = __atomic_load_n(&bl->plays[j], __ATOMIC_ACQUIRE);
+            if (!plays)
+            {
+                continue;
+            }
+
+            square move = rootMove(tr, bl, j);
+            s->wins[move] += __atomic_load_n(&bl->wins[j], __ATOMIC_RELAXED);
+            s->plays[move] += plays;
+        }
+    }
 }
 
 // prints the ai
 // ai -> the ai to print
 void printAI(AI *ai)
 {
+    summary s;
+    summarizeAI(ai, &s);
+
     // stats of current position
-    double score = ai->tree->root->wins / (double)ai->tree->root->plays;
-    int depth = getDepth(ai->tree->root);
+    double score = s.total_wins / (64.0 * s.total_plays);
+    int depth = getDepth(&ai->trees[0]->root);
 
-    printf("C  Net: %+.2f\n", 2*(64*(1 - score) - 32));
+    size_t in_use = 0;
+    size_t saved = 0;
+    uint64_t hits = 0;
+    uint64_t stores = 0;
+    size_t pruned = 0;
+    int prunes = 0;
+    for (int i = 0; i < ai->tree_count; i++)
+    {
+        in_use += treeMemory(ai->trees[i]);
+        pruned += ai->trees[i]->pruned;
+        prunes += ai->trees[i]->prunes;
+        saved += ai->trees[i]->saved;
+        hits += ai->trees[i]->hits;
+        stores += ai->trees[i]->stores;
+    }
+
+    // a single move, or only symmetric copies of one, is played unsearched
+    if (s.total_plays)
+    {
+        printf("C  Net: %+.2f\n", 2*(64*(1 - score) - 32));
+    }
+    else
+    {
+        printf("C  Net: none, the move was settled without a search\n");
+    }
     printf("C  Depth: %i\n", depth);
-    printf("C  Plays: %'i\n", ai->tree->root->plays);
+    printf("C  Plays: %'u\n", s.total_plays);
+    printf("C  Speed: %'i playouts/s\n", ai->search_time > 0 ? (int) (ai->playouts / ai->search_time) : 0);
+    if (ai->cfg.ponder)
+    {
+        printf("C  Ponder: %'u playouts\n", ai->ponder_playouts);
+    }
+    if (ai->solution.nodes)
+    {
+        solution *sol = &ai->solution;
+        printf("C  Solve: %s %+i in %.3fs, %'llu nodes (%'i nodes/s)\n",
+            sol->solved ? "exact" : "gave up, was", sol->score, sol->seconds,
+            (unsigned long long) sol->nodes, sol->seconds > 0 ? (int) (sol->nodes / sol->seconds) : 0);
+    }
+    if (ai->opening.games)
+    {
+        printf("C  Book: %+i over %'u games\n", ai->opening.score, ai->opening.games);
+    }
     printf("C  Time Left: %ims\n", (int) ((ai->seconds - ai->time_spent) * 1000));
+    printf("C  Memory: %'zu KiB in use, %'zu KiB reclaimed in %.1fms\n", in_use / 1024, ai->reclaimed / 1024, ai->reclaim_time * 1000);
+    if (ai->cfg.memory)
+    {
+        printf("C  Pruned: %'zu KiB in %i passes, capped at %'zu KiB\n", pruned / 1024, prunes, ai->cfg.memory / 1024);
+    }
+    printf("C  Transpositions: %.1f%% of expansions shared, %'zu KiB saved\n", hits + stores ? 100.0 * hits / (hits + stores) : 0, saved / 1024);
+    printStats();
+    if (ai->cfg.dump)
+    {
+        board *b = &ai->trees[0]->root.b;
+        dumpStats(ai->cfg.dump, 64 - __builtin_popcountll(b->pieces[0] | b->pieces[1]));
+    }
 
     // stats for candidate moves
-    for (int i = 0; i < ai->tree->root->node_count; i++)
+    for (int move = 0; move <= PASS; move++)
     {
-        node *node = ai->tree->root->next[i];
-        double score = node->wins / (double)node->plays;
+        if (!s.plays[move])
+        {
+            continue;
+        }
+
+        double score = s.wins[move] / (64.0 * s.plays[move]);
 
-        if (node->move)
+        if (move != PASS)
         {
             // get move
-            int move = log(node->move) / log(2);
             char file = 97 + move % 8;
             int rank = move / 8 + 1;
 
-            printf("C   - %c%i -> %+.2f of %'i plays\n", file, rank, 2*(64*score - 32), node->plays);
+            printf("C   - %c%i -> %+.2f of %'u plays\n", file, rank, 2*(64*score - 32), s.plays[move]);
         }
         else
         {
-            printf("C   - _p -> %+.2f of %'i plays\n", 64*score - 32, node->plays);
+            printf("C   - _p -> %+.2f of %'u plays\n", 64*score - 32, s.plays[move]);
         }
     }
 
-}
\ No newline at end of file
+}
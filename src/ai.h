@@ -1,23 +1,139 @@
+# ifndef AI_H
+# define AI_H
+
+# include <stdio.h>
+# include <pthread.h>
 # include "tree.h"
+# include "solve.h"
+# include "book.h"
+# include "snapshot.h"
+# include "reclaim.h"
+# include "clock.h"
+
+// config struct
+// seconds -> the number of seconds allotted for the game
+// playouts -> playouts searched per move instead of searching on the clock,
+//             or 0
+// nodes -> tree nodes created per move instead of searching on the clock, or
+//          0, the search stopping at whichever budget runs out first
+// threads -> the number of search threads
+// shared -> whether the threads search one shared tree instead of a tree each
+// ponder -> whether to keep searching while the opponent thinks
+// endgame -> number of empty squares from which positions are solved exactly
+// dump -> file the search counters are written to after each move, or NULL
+// book -> opening book played from before searching, or NULL
+// snapshot -> file the first tree of the starting position is loaded from
+//             and saved to, or NULL
+// seed -> seed of the search threads' random streams, or 0 to use the clock
+// memory -> bytes the trees may use together before they are pruned, or 0
+// reclaimer -> releases discarded subtrees for every ai sharing it, or NULL
+//              for each ai to start its own
+typedef struct
+{
+    int seconds;
+    uint32_t playouts;
+    uint64_t nodes;
+    int threads;
+    int shared;
+    int ponder;
+    int endgame;
+    FILE *dump;
+    book *book;
+    const char *snapshot;
+    uint64_t seed;
+    size_t memory;
+    reclaimer *reclaimer;
+} config;
 
 // ai struct
-// tree -> the search space 
+// trees -> the search spaces, all rooted at the game state
+// tree_count -> one tree per thread, or a single one shared by all threads
+// rngs -> random number generators, one per thread
+// cfg -> the settings the ai was created with
 // seconds -> the number of seconds allotted for the game
+// reclaimer -> releases the subtrees discarded by moves in the background
+// reclaimed -> bytes returned to the trees' arenas between the last two searches
+// reclaim_time -> seconds the reclaimer spent between the last two searches
+// playouts -> number of playouts run by the last search, over all threads
+// search_time -> seconds taken by the last search
+// start_time -> wall clock time at which the last search started
+// start_plays -> total root plays when the last search started
+// deadline -> wall clock time at which the running search stops
+// stop -> set to end the running search before its deadline
+// running -> whether search threads are running
+// ids -> the running search threads
+// workers -> arguments of the running search threads
+// ponder_playouts -> playouts run on the opponent's time before the last search
+// ponder_start -> total root plays when pondering started
+// solution -> result of the last endgame solve, with no nodes if none was tried
+// opening -> the book record of the last move, with no games if it was searched
+// loaded -> root plays loaded into the first tree when the ai was created
+// saved -> whether the tree of the starting position has been saved
 typedef struct
 {
-    tree *tree;
+    tree **trees;
+    int tree_count;
+    rng *rngs;
+    config cfg;
     double seconds;
     double time_spent;
+    reclaimer *reclaimer;
+    size_t reclaimed;
+    double reclaim_time;
+    uint32_t playouts;
+    double search_time;
+    double start_time;
+    uint32_t start_plays;
+    double deadline;
+    int stop;
+    int running;
+    pthread_t *ids;
+    struct worker *workers;
+    uint32_t ponder_playouts;
+    uint32_t ponder_start;
+    solution solution;
+    record opening;
+    uint32_t loaded;
+    int saved;
 } AI;
 
-AI *createAI(board *b, int seconds);
+// root statistics of every tree combined, indexed by move
+// wins -> discs won after each move, summed over the trees
+// plays -> number of times each move was visited, summed over the trees
+// total_wins -> discs won under the root
+// total_plays -> number of times the root was visited
+typedef struct
+{
+    uint64_t wins[PASS + 1];
+    uint32_t plays[PASS + 1];
+    uint64_t total_wins;
+    uint32_t total_plays;
+} summary;
+
+AI *createAI(board *b, config *cfg);
 
 void destroyAI(AI *ai);
 
 bitboard calcBestMove(AI *ai);
 
+int beginMove(AI *ai, double start, bitboard *move);
+
+int stepMove(AI *ai, int rounds);
+
+bitboard endMove(AI *ai);
+
+void saveAI(AI *ai);
+
 void updateAI(AI *ai, bitboard move);
 
+void startPonder(AI *ai);
+
+void stopPonder(AI *ai);
+
+void summarizeAI(AI *ai, summary *s);
+
 void printAI(AI *ai);
 
-double getTime(AI *ai);
\ No newline at end of file
+double getTime(AI *ai);
+
+# endif
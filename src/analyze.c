@@ -0,0 +1,176 @@
+# include <string.h>
+# include "analyze.h"
+# include "clock.h"
+
+// rounds searched between looks at the clock
+# define ANALYZE_ROUNDS 64
+
+// a position waiting to be searched
+// an -> the analysis it belongs to
+// line -> the input line it was read from
+// b -> the position
+typedef struct
+{
+    analysis *an;
+    size_t line;
+    board b;
+} job;
+
+// reads a position written as the black and white bitboards in hex and the
+// side to move, such as "0000000810000000 0000001008000000 B"
+// str -> the line to read
+// b -> filled with the position
+// returns -> 0 on success, -1 if the line is not a position
+static int parsePosition(const char *str, board *b)
+{
+    unsigned long long pieces[2];
+    char side;
+    if (sscanf(str, "%llx %llx %c", &pieces[0], &pieces[1], &side) != 3 || (pieces[0] & pieces[1]))
+    {
+        return -1;
+    }
+
+    if (side == 'B' || side == 'b' || side == '0')
+    {
+        b->turn = black;
+    }
+    else if (side == 'W' || side == 'w' || side == '1')
+    {
+        b->turn = white;
+    }
+    else
+    {
+        return -1;
+    }
+
+    b->pieces[0] = pieces[0];
+    b->pieces[1] = pieces[1];
+    b->moves = getMoves(b);
+    b->hash = hashBoard(b);
+    return 0;
+}
+
+// searches a position within the analysis budget and prints the most played
+// move, its score in discs for the side to move, and the playouts searched
+// arg -> the job of the position
+static void analyzePosition(void *arg)
+{
+    job *jb = (job *) arg;
+    analysis *an = jb->an;
+    board *b = &jb->b;
+
+    char move_str[8] = "pass";
+    double net = 0;
+    uint32_t playouts = 0;
+
+    if (gameOver(b))
+    {
+        // the final disc difference, the empty squares left uncounted
+        strcpy(move_str, "end");
+        net = __builtin_popcountll(b->pieces[b->turn]) - __builtin_popcountll(b->pieces[b->turn ^ 1]);
+    }
+    else if (__builtin_popcountll(childMoves(b)) == 1)
+    {
+        // a single move, or moves that are all symmetric copies of one, is
+        // settled without a search, like a pass
+        square sq = bitMove(childMoves(b));
+        sprintf(move_str, "%c%i", 'a' + sq % 8, sq / 8 + 1);
+    }
+    else if (b->moves)
+    {
+        tree *tr = createTree(b);
+        rng r;
+        seedRandom(&r, an->seed + jb->line);
+
+        // a node budget also ends once a whole batch adds no node, as the
+        // tree left may be smaller than the budget
+        double deadline = an->seconds > 0 ? getClock() + an->seconds : INFINITY;
+        uint64_t nodes = 0;
+        for (int rounds = 0; (!an->playouts || tr->plays < an->playouts) && (!an->nodes || tr->nodes < an->nodes); rounds++)
+        {
+            if (rounds % ANALYZE_ROUNDS == 0)
+            {
+                if (getClock() >= deadline || (an->nodes && rounds && tr->nodes == nodes))
+                {
+                    break;
+                }
+                nodes = tr->nodes;
+            }
+            doRound(tr, &r);
+        }
+
+        // the root is expanded by the first round
+        block *bl = tr->root.next;
+        int best = 0;
+        for (int i = 1; bl && i < bl->child_count; i++)
+        {
+            if (bl->plays[i] > bl->plays[best])
+            {
+                best = i;
+            }
+        }
+
+        if (bl && bl->plays[best])
+        {
+            uint8_t sq = rootMove(tr, bl, best);
+            sprintf(move_str, "%c%i", 'a' + sq % 8, sq / 8 + 1);
+            net = 2 * ((double) bl->wins[best] / bl->plays[best] - 32);
+        }
+        playouts = tr->plays;
+
+        deleteTree(tr);
+    }
+
+    pthread_mutex_lock(&an->lock);
+    printf("%zu %s %+.2f %u\n", jb->line, move_str, net, playouts);
+    fflush(stdout);
+    pthread_mutex_unlock(&an->lock);
+
+    free(jb);
+}
+
+// searches every position of a stream on a pool of workers, printing one
+// line per position as its search ends: the input line number, the best
+// move, its score and the playouts searched
+// blank lines and lines starting with '#' are skipped
+// an -> the settings of the analysis
+// in -> the stream of positions, one per line
+// returns -> number of lines that were not positions
+int analyzePositions(analysis *an, FILE *in)
+{
+    pthread_mutex_init(&an->lock, NULL);
+    pool *p = createPool(an->workers);
+
+    int errors = 0;
+    char str[256];
+    for (size_t line = 1; fgets(str, sizeof(str), in); line++)
+    {
+        if (str[0] == '\n' || str[0] == '#')
+        {
+            continue;
+        }
+
+        job *jb = (job *) malloc(sizeof(job));
+        jb->an = an;
+        jb->line = line;
+        if (parsePosition(str, &jb->b) < 0)
+        {
+            pthread_mutex_lock(&an->lock);
+            fprintf(stderr, "line %zu: not a position\n", line);
+            pthread_mutex_unlock(&an->lock);
+            free(jb);
+            errors++;
+            continue;
+        }
+
+        // keep reading only as fast as the workers search
+        waitPool(p, (size_t) an->workers * ANALYZE_BACKLOG);
+        submitTask(p, (task) { analyzePosition, jb });
+    }
+
+    waitPool(p, 0);
+    deletePool(p);
+    pthread_mutex_destroy(&an->lock);
+
+    return errors;
+}
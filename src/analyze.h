@@ -0,0 +1,33 @@
+# ifndef ANALYZE_H
+# define ANALYZE_H
+
+# include "tree.h"
+# include "workers.h"
+
+// positions kept waiting for a worker per worker, bounding the memory used
+// when reading long streams
+# define ANALYZE_BACKLOG 16
+
+// playouts searched per position when no budget is given
+# define ANALYZE_PLAYOUTS 100000
+
+// settings of a batch analysis
+// playouts -> playouts searched per position, or 0 for no limit
+// nodes -> tree nodes created per position, or 0 for no limit
+// seconds -> seconds searched per position, or 0 for no limit
+// workers -> number of positions searched at the same time
+// seed -> seed of the first position, each position using the next one
+// lock -> keeps result lines whole
+typedef struct
+{
+    uint32_t playouts;
+    uint64_t nodes;
+    double seconds;
+    int workers;
+    uint64_t seed;
+    pthread_mutex_t lock;
+} analysis;
+
+int analyzePositions(analysis *an, FILE *in);
+
+# endif
@@ -0,0 +1,150 @@
+# include "arena.h"
+# include "stats.h"
+
+// header of an allocation too big for the slabs
+// next -> the next such allocation of the arena, or NULL
+// prev -> the link pointing at this header
+typedef struct large
+{
+    struct large *next;
+    struct large **prev;
+} large;
+
+// rounds a size up to its size class
+// size -> the requested number of bytes
+// returns -> the size class index
+static size_t sizeClass(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) / ARENA_ALIGN;
+}
+
+// creates an empty arena, slabs are only requested once needed
+// returns -> the new arena
+arena *createArena()
+{
+    arena *a = (arena *) calloc(1, sizeof(arena));
+    return a;
+}
+
+// frees every slab and large allocation at once, invalidating all
+// allocations from the arena
+// a -> the arena to delete
+void deleteArena(arena *a)
+{
+    void *slab = a->slabs;
+    while (slab)
+    {
+        void *next = *(void **) slab;
+        free(slab);
+        slab = next;
+    }
+
+    large *l = (large *) a->large;
+    while (l)
+    {
+        large *next = l->next;
+        free(l);
+        l = next;
+    }
+
+    free(a);
+}
+
+// allocates memory from the arena
+// reuses a freed allocation of the same size class when one is available,
+// and otherwise carves a new one out of the newest slab
+// a -> the arena to allocate from
+// size -> the number of bytes needed
+// returns -> pointer to the memory
+void *arenaAlloc(arena *a, size_t size)
+{
+    size_t class = sizeClass(size);
+    size_t bytes = class * ARENA_ALIGN;
+
+    // oversized allocations bypass the slabs, but are listed so that
+    // deleting the arena frees them too
+    if (bytes > ARENA_MAX)
+    {
+        a->in_use += bytes;
+        countAlloc(bytes);
+        countMalloc();
+
+        large *l = (large *) malloc(ARENA_ALIGN + bytes);
+        l->next = (large *) a->large;
+        l->prev = (large **) &a->large;
+        if (l->next)
+        {
+            l->next->prev = &l->next;
+        }
+        a->large = l;
+        return (char *) l + ARENA_ALIGN;
+    }
+
+    a->in_use += bytes;
+    countAlloc(bytes);
+
+    // pop from the free list
+    void *p = a->free[class];
+    if (p)
+    {
+        a->free[class] = *(void **) p;
+        return p;
+    }
+
+    // start a new slab, the first bytes link it into the slab list
+    if (a->top + bytes > a->end)
+    {
+        char *slab = (char *) malloc(ARENA_SLAB);
+        *(void **) slab = a->slabs;
+        a->slabs = slab;
+        a->top = slab + ARENA_ALIGN;
+        a->end = slab + ARENA_SLAB;
+        a->reserved += ARENA_SLAB;
+        countMalloc();
+    }
+
+    p = a->top;
+    a->top += bytes;
+    return p;
+}
+
+// returns memory to the arena so it can be reused
+// a -> the arena the memory came from
+// p -> the memory to return
+// size -> the number of bytes that were requested for it
+void arenaFree(arena *a, void *p, size_t size)
+{
+    if (!p)
+    {
+        return;
+    }
+
+    size_t class = sizeClass(size);
+    size_t bytes = class * ARENA_ALIGN;
+
+    a->in_use -= bytes;
+    a->reclaimed += bytes;
+
+    if (bytes > ARENA_MAX)
+    {
+        large *l = (large *) ((char *) p - ARENA_ALIGN);
+        *l->prev = l->next;
+        if (l->next)
+        {
+            l->next->prev = l->prev;
+        }
+        free(l);
+        return;
+    }
+
+    // push onto the free list
+    *(void **) p = a->free[class];
+    a->free[class] = p;
+}
+
+// starts a new reclaim count, called once per move
+// a -> the arena to mark
+void arenaMark(arena *a)
+{
+    a->reclaimed = 0;
+}
@@ -0,0 +1,48 @@
+# ifndef ARENA_H
+# define ARENA_H
+
+# include <stdlib.h>
+# include <stdint.h>
+
+// allocations are rounded up to a multiple of this many bytes
+# define ARENA_ALIGN 16
+
+// largest allocation served from the slabs, anything bigger goes to malloc
+// behind a header of ARENA_ALIGN bytes linking it into the arena's list
+# define ARENA_MAX 4096
+
+// size of each slab requested from the system
+# define ARENA_SLAB (1 << 20)
+
+// arena struct
+// slabs -> linked list of chunks that allocations are carved from
+// large -> doubly linked list of the allocations too big for the slabs
+// top -> start of the unused space in the newest slab
+// end -> end of the newest slab
+// free -> free lists of returned allocations, one per size class
+// in_use -> bytes currently handed out
+// reserved -> bytes requested from the system
+// reclaimed -> bytes returned since the last call to arenaMark
+typedef struct arena
+{
+    void *slabs;
+    void *large;
+    char *top;
+    char *end;
+    void *free[ARENA_MAX / ARENA_ALIGN + 1];
+    size_t in_use;
+    size_t reserved;
+    size_t reclaimed;
+} arena;
+
+arena *createArena();
+
+void deleteArena(arena *a);
+
+void *arenaAlloc(arena *a, size_t size);
+
+void arenaFree(arena *a, void *p, size_t size);
+
+void arenaMark(arena *a);
+
+# endif
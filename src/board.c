@@ -1,4 +1,7 @@
+# include <immintrin.h>
 # include "board.h"
+# include "lines.h"
+# include "keys.h"
 
 dir dirs[8] = {up, down, left, right, upleft, upright, downleft, downright};
 
@@ -12,6 +15,7 @@ board *createBoard()
     b->pieces[1] = 0x1008000000;
     b->moves = 0x102004080000;
     b->turn = black;
+    b->hash = hashBoard(b);
 
     return b;
 }
@@ -26,11 +30,30 @@ board *cloneBoard(board *b)
     new_b->pieces[0] = b->pieces[0];
     new_b->pieces[1] = b->pieces[1];
     new_b->moves = b->moves;
+    new_b->hash = b->hash;
     new_b->turn = b->turn;
 
     return new_b;
 }
 
+// computes the zobrist hash of a board from scratch
+// b -> the board to hash
+// returns -> the hash
+bitboard hashBoard(board *b)
+{
+    bitboard hash = b->turn == white ? turn_key : 0ULL;
+
+    for (int color = 0; color < 2; color++)
+    {
+        for (bitboard bb = b->pieces[color]; bb; bb &= bb - 1)
+        {
+            hash ^= keys[color][__builtin_ctzll(bb)];
+        }
+    }
+
+    return hash;
+}
+
 // prints the board and some useful data to stdout
 // b -> the board to show 
 void printBoard(board *b) 
@@ -131,10 +154,10 @@ bitboard shift(bitboard bb, dir d)
     return bb;
 }
 
-// gets all legal moves
+// gets all legal moves, one direction at a time
 // b -> the board to get moves from
 // returns -> a bitboard with all legal moves
-bitboard getMoves(board *b)
+static bitboard getMovesScalar(board *b)
 {
     bitboard moves = 0ULL;
 
@@ -166,51 +189,452 @@ bitboard getMoves(board *b)
     return moves;
 }
 
+// gets all legal moves, with the 8 directions split over two vectors of 4
+// lanes (one shifting left, one shifting right) and a Kogge-Stone fill that
+// always takes 3 steps, so there are no loops or data-dependent branches
+// b -> the board to get moves from
+// returns -> a bitboard with all legal moves
+__attribute__((target("avx2")))
+static bitboard getMovesAVX2(board *b)
+{
+    // lanes: right / left, down / up, downright / upleft, downleft / upright
+    const __m256i shift1 = _mm256_set_epi64x(7, 9, 8, 1);
+    const __m256i shift2 = _mm256_slli_epi64(shift1, 1);
+    const __m256i shift4 = _mm256_slli_epi64(shift1, 2);
+    const __m256i mask_l = _mm256_set_epi64x(downleft, downright, down, right);
+    const __m256i mask_r = _mm256_set_epi64x(upright, upleft, up, left);
+
+    __m256i own = _mm256_set1_epi64x(b->pieces[b->turn]);
+    __m256i opp = _mm256_set1_epi64x(b->pieces[b->turn^1]);
+
+    // as in the scalar version, pieces on the far edge of a direction never
+    // take part in a flank
+    __m256i gen_l = _mm256_and_si256(own, mask_l);
+    __m256i gen_r = _mm256_and_si256(own, mask_r);
+    __m256i pro_l = _mm256_and_si256(opp, mask_l);
+    __m256i pro_r = _mm256_and_si256(opp, mask_r);
+    __m256i opp_l = pro_l;
+    __m256i opp_r = pro_r;
+
+    // flood over runs of opponent pieces by 1, 2 and then 4 squares
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(pro_l, _mm256_sllv_epi64(gen_l, shift1)));
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(pro_r, _mm256_srlv_epi64(gen_r, shift1)));
+    pro_l = _mm256_and_si256(pro_l, _mm256_sllv_epi64(pro_l, shift1));
+    pro_r = _mm256_and_si256(pro_r, _mm256_srlv_epi64(pro_r, shift1));
+
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(pro_l, _mm256_sllv_epi64(gen_l, shift2)));
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(pro_r, _mm256_srlv_epi64(gen_r, shift2)));
+    pro_l = _mm256_and_si256(pro_l, _mm256_sllv_epi64(pro_l, shift2));
+    pro_r = _mm256_and_si256(pro_r, _mm256_srlv_epi64(pro_r, shift2));
+
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(pro_l, _mm256_sllv_epi64(gen_l, shift4)));
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(pro_r, _mm256_srlv_epi64(gen_r, shift4)));
+
+    // one step past the flooded opponent pieces
+    __m256i moves = _mm256_or_si256(
+        _mm256_sllv_epi64(_mm256_and_si256(gen_l, opp_l), shift1),
+        _mm256_srlv_epi64(_mm256_and_si256(gen_r, opp_r), shift1)
+    );
+
+    // combine the 4 lanes
+    __m128i half = _mm_or_si128(_mm256_castsi256_si128(moves), _mm256_extracti128_si256(moves, 1));
+    bitboard all = _mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1);
+
+    return all & ~(b->pieces[0] | b->pieces[1]);
+}
+
+// gets all legal moves, with the generator of the instruction set picked at
+// startup by initCPU
+// b -> the board to get moves from
+// returns -> a bitboard with all legal moves
+bitboard (*getMoves)(board *b) = getMovesScalar;
+
+// finds the n-th set bit with a binary search over popcounts of halves
+// bb -> the bitboard to search
+// index -> which set bit to find, counting from the least significant
+// returns -> a bitboard with only that bit set
+static bitboard selectBitScalar(bitboard bb, int index)
+{
+    int base = 0;
+
+    for (int width = 32; width > 0; width /= 2)
+    {
+        int low = __builtin_popcountll((bb >> base) & ((1ULL << width) - 1));
+        int high = index >= low;
+
+        index -= high * low;
+        base += high * width;
+    }
+
+    return 1ULL << base;
+}
+
+// finds the n-th set bit by depositing a single bit into the set bits
+// bb -> the bitboard to search
+// index -> which set bit to find, counting from the least significant
+// returns -> a bitboard with only that bit set
+__attribute__((target("bmi2")))
+static bitboard selectBitBMI2(bitboard bb, int index)
+{
+    return _pdep_u64(1ULL << index, bb);
+}
+
+// finds the n-th set bit of a bitboard in constant time, with the kernel of
+// the instruction set picked at startup by initCPU
+// bb -> the bitboard to search
+// index -> which set bit to find, counting from the least significant
+// returns -> a bitboard with only that bit set
+bitboard (*selectBit)(bitboard bb, int index) = selectBitScalar;
+
+// checks whether neither side has a legal move left
+// b -> the board to check
+// returns -> nonzero if the game is over
+int gameOver(board *b)
+{
+    if (b->moves)
+    {
+        return 0;
+    }
+
+    board opp = *b;
+    opp.turn ^= 1;
+    return !getMoves(&opp);
+}
+
+// computes the pieces flipped by a move, using the line masks from lines.h
+// in every direction the nearest square that is not an opponent piece is
+// found with one bit scan, and the line up to it flips if it is an own piece
+// inlined into each playout variant, so the bit scans use its instructions
+// b -> the board the move is played on
+// sq -> the square of the move
+// returns -> a bitboard of the flipped pieces, excluding the move itself
+static inline __attribute__((always_inline)) bitboard findFlips(board *b, square sq)
+{
+    bitboard own = b->pieces[b->turn];
+    bitboard opp = b->pieces[b->turn^1];
+    const bitboard *line = lines[sq];
+    bitboard flips = 0ULL;
+
+    // directions towards higher squares, the blocker is the lowest bit
+    for (int i = 0; i < 4; i++)
+    {
+        bitboard stop = line[i] & ~opp;
+        bitboard first = stop & -stop;
+        bitboard outflank = -(bitboard) ((first & own) != 0);
+
+        flips |= line[i] & (first - 1) & outflank;
+    }
+
+    // directions towards lower squares, the blocker is the highest bit
+    for (int i = 4; i < 8; i++)
+    {
+        bitboard stop = line[i] & ~opp;
+        bitboard first = 1ULL << (63 - __builtin_clzll(stop | 1));
+        bitboard outflank = -(bitboard) ((first & own & line[i]) != 0);
+
+        flips |= line[i] & -(first << 1) & outflank;
+    }
+
+    return flips;
+}
+
+// computes the pieces flipped by a move
+// b -> the board the move is played on
+// sq -> the square of the move
+// returns -> a bitboard of the flipped pieces, excluding the move itself
+bitboard getFlips(board *b, square sq)
+{
+    return findFlips(b, sq);
+}
+
+// plays a move on the board's pieces and passes the turn
+// b -> the board to make the move on
+// bb -> a bitboard with one bit set for the move, or no bits for a pass
+// returns -> the pieces flipped by the move
+static inline __attribute__((always_inline)) bitboard applyMove(board *b, bitboard bb)
+{
+    bitboard flips = 0ULL;
+
+    if (bb)
+    {
+        flips = findFlips(b, __builtin_ctzll(bb));
+
+        b->pieces[b->turn] |= flips | bb;
+        b->pieces[b->turn^1] ^= flips;
+    }
+
+    b->turn ^= 1;
+    return flips;
+}
+
+// plays a move without checking it or regenerating legal moves, for callers
+// that already know the move is legal and get the next moves themselves
+// b -> the board to make the move on, b->moves and b->hash are left unchanged
+// bb -> a bitboard with one bit set for the move, or no bits for a pass
+// returns -> the pieces flipped by the move
+bitboard playMove(board *b, bitboard bb)
+{
+    return applyMove(b, bb);
+}
+
+// plays random moves until both sides pass, the body of every playout
+// variant, which pass their own kernels so that each is inlined
+// b -> the board to play on, left at the final position
+// r -> random number generator of the playout
+// moves_of -> the move generator
+// select -> the bit select
+static inline __attribute__((always_inline)) void playRandom(board *b, rng *r, bitboard (*moves_of)(board *b), bitboard (*select)(bitboard bb, int index))
+{
+    int pass_count = 0;
+    while (pass_count < 2)
+    {
+        bitboard moves = b->moves;
+
+        if (!moves)
+        {
+            applyMove(b, 0x0);
+            pass_count++;
+        }
+        else
+        {
+            // pick random index - find and play that move
+            int index = randomBelow(r, __builtin_popcountll(moves));
+            applyMove(b, select(moves, index));
+            pass_count = 0;
+        }
+
+        // moves are only regenerated once the playout knows it needs them
+        b->moves = moves_of(b);
+    }
+}
+
+// plays a random game on plain x86-64
+// b -> the board to play on, left at the final position
+// r -> random number generator of the playout
+static void playRandomBaseline(board *b, rng *r)
+{
+    playRandom(b, r, getMovesScalar, selectBitScalar);
+}
+
+// plays a random game with hardware popcounts
+// b -> the board to play on, left at the final position
+// r -> random number generator of the playout
+__attribute__((target("popcnt")))
+static void playRandomPOPCNT(board *b, rng *r)
+{
+    playRandom(b, r, getMovesScalar, selectBitScalar);
+}
+
+// plays a random game with pdep bit selects and lzcnt bit scans
+// b -> the board to play on, left at the final position
+// r -> random number generator of the playout
+__attribute__((target("popcnt,bmi,bmi2,lzcnt")))
+static void playRandomBMI2(board *b, rng *r)
+{
+    playRandom(b, r, getMovesScalar, selectBitBMI2);
+}
+
+// plays a random game with the vector move generator
+// b -> the board to play on, left at the final position
+// r -> random number generator of the playout
+__attribute__((target("popcnt,bmi,bmi2,lzcnt,avx2")))
+static void playRandomAVX2(board *b, rng *r)
+{
+    playRandom(b, r, getMovesAVX2, selectBitBMI2);
+}
+
+// plays random moves until both sides pass, with the variant of the
+// instruction set picked at startup by initCPU
+// b -> the board to play on, left at the final position
+// r -> random number generator of the playout
+void (*playRandomGame)(board *b, rng *r) = playRandomBaseline;
+
 // makes a move
 // b -> the board to make the move on
 // bb -> a bitboard with one bit set, corresponding to the move
 void makeMove(board *b, bitboard bb)
 {
-    // flipping logic
-    if (b->moves & bb)
+    // play legal moves, or a pass when there are none
+    if ((b->moves & bb) || !b->moves)
     {
-        bitboard flips = 0ULL;
+        bb = b->moves ? bb : 0x0;
+        bitboard flips = playMove(b, bb);
 
-        // for each direction
-        for (int i = 0; i < sizeof(dirs) / sizeof(dir); i++)
+        // update the hash with the placed piece, every flipped piece and the
+        // change of turn
+        b->hash ^= turn_key;
+        if (bb)
         {
-            bitboard flipset = bb & dirs[i];
-            bitboard opp = b->pieces[b->turn^1] & dirs[i];
-
-            // shifts the bits in a direction, and iteratively builds up flippable
-            // pieces by shifting previous found locations onto the opponents pieces,
-            // and finding a match
-            bitboard prev;
-            do
-            {
-                prev = flipset;
-                flipset |= opp & shift(flipset, dirs[i]);
-            } while (prev != flipset);
+            b->hash ^= keys[b->turn^1][__builtin_ctzll(bb)];
+        }
 
-            // only add to flips if the next location in the direction is one of
-            // your own pieces
-            if (b->pieces[b->turn] & shift(flipset, dirs[i]))
-            {
-                flips |= flipset;
-            }
+        for (; flips; flips &= flips - 1)
+        {
+            int sq = __builtin_ctzll(flips);
+            b->hash ^= keys[0][sq] ^ keys[1][sq];
         }
+    }
+
+    // regenerate legal moves
+    b->moves = getMoves(b);
+}
 
-        // set pieces and change turn
-        b->pieces[b->turn] |= flips;
-        b->pieces[b->turn^1] ^= flips & ~bb;
-        b->turn ^= 1;
+// flips a bitboard upside down, swapping rank 1 with rank 8
+// bb -> the bitboard to flip
+// returns -> the flipped bitboard
+static bitboard flipBits(bitboard bb)
+{
+    return __builtin_bswap64(bb);
+}
+
+// mirrors a bitboard left to right, swapping file a with file h
+// bb -> the bitboard to mirror
+// returns -> the mirrored bitboard
+static bitboard mirrorBits(bitboard bb)
+{
+    bb = ((bb >> 1) & 0x5555555555555555ULL) | ((bb & 0x5555555555555555ULL) << 1);
+    bb = ((bb >> 2) & 0x3333333333333333ULL) | ((bb & 0x3333333333333333ULL) << 2);
+    bb = ((bb >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((bb & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return bb;
+}
 
+// transposes a bitboard along the a1-h8 diagonal, swapping files and ranks
+// bb -> the bitboard to transpose
+// returns -> the transposed bitboard
+static bitboard transposeBits(bitboard bb)
+{
+    bitboard t;
+    t = 0x0F0F0F0F00000000ULL & (bb ^ (bb << 28));
+    bb ^= t ^ (t >> 28);
+    t = 0x3333000033330000ULL & (bb ^ (bb << 14));
+    bb ^= t ^ (t >> 14);
+    t = 0x5500550055005500ULL & (bb ^ (bb << 7));
+    bb ^= t ^ (t >> 7);
+    return bb;
+}
+
+// applies one of the board's symmetries to a bitboard
+// bb -> the bitboard to transform
+// sym -> the symmetry, below SYMMETRIES
+// returns -> the transformed bitboard
+bitboard transformBits(bitboard bb, int sym)
+{
+    if (sym & 4)
+    {
+        bb = transposeBits(bb);
     }
-    // force pass
-    else if (!b->moves)
+    if (sym & 2)
     {
-        b->turn ^= 1;
+        bb = mirrorBits(bb);
     }
-    // regenerate legal moves
-    b->moves = getMoves(b);
-}
\ No newline at end of file
+    if (sym & 1)
+    {
+        bb = flipBits(bb);
+    }
+    return bb;
+}
+
+// undoes transformBits
+// bb -> the transformed bitboard
+// sym -> the symmetry it was transformed with
+// returns -> the original bitboard
+bitboard restoreBits(bitboard bb, int sym)
+{
+    if (sym & 1)
+    {
+        bb = flipBits(bb);
+    }
+    if (sym & 2)
+    {
+        bb = mirrorBits(bb);
+    }
+    if (sym & 4)
+    {
+        bb = transposeBits(bb);
+    }
+    return bb;
+}
+
+// hashes a board the same way as all of its symmetric copies, by taking the
+// smallest hash over the symmetries
+// b -> the board to hash
+// sym -> if not NULL, filled with the symmetry giving that hash, so that
+//        transformBits takes the board's moves to the canonical orientation
+// returns -> the canonical hash
+bitboard canonicalHash(board *b, int *sym)
+{
+    bitboard best = 0;
+    int best_sym = 0;
+
+    for (int s = 0; s < SYMMETRIES; s++)
+    {
+        board t = { .pieces = { transformBits(b->pieces[0], s), transformBits(b->pieces[1], s) }, .turn = b->turn };
+        bitboard hash = hashBoard(&t);
+        if (s == 0 || hash < best)
+        {
+            best = hash;
+            best_sym = s;
+        }
+    }
+
+    if (sym)
+    {
+        *sym = best_sym;
+    }
+    return best;
+}
+
+// keeps one move of each set of moves that the board's own symmetries take to
+// one another, as they all lead to copies of the same position
+// b -> the board whose moves are filtered
+// returns -> the moves, the lowest square standing for each set
+bitboard distinctMoves(board *b)
+{
+    int syms[SYMMETRIES];
+    int sym_count = 0;
+    for (int s = 1; s < SYMMETRIES; s++)
+    {
+        if (transformBits(b->pieces[0], s) == b->pieces[0] && transformBits(b->pieces[1], s) == b->pieces[1])
+        {
+            syms[sym_count++] = s;
+        }
+    }
+
+    if (!sym_count)
+    {
+        return b->moves;
+    }
+
+    // a move's images include every lower move of its set, so the lowest is
+    // the first one kept
+    bitboard kept = 0;
+    for (bitboard moves = b->moves; moves; moves &= moves - 1)
+    {
+        bitboard move = moves & -moves;
+        bitboard images = 0;
+        for (int i = 0; i < sym_count; i++)
+        {
+            images |= transformBits(move, syms[i]);
+        }
+
+        if (!(images & kept))
+        {
+            kept |= move;
+        }
+    }
+
+    return kept;
+}
+
+// points the board kernels at the variants of an instruction set level
+// level -> the level, which the cpu must support
+void useBoardKernels(isa level)
+{
+    static bitboard (*const move_kernels[isa_count])(board *b) = { getMovesScalar, getMovesScalar, getMovesScalar, getMovesAVX2 };
+    static bitboard (*const select_kernels[isa_count])(bitboard bb, int index) = { selectBitScalar, selectBitScalar, selectBitBMI2, selectBitBMI2 };
+    static void (*const playout_kernels[isa_count])(board *b, rng *r) = { playRandomBaseline, playRandomPOPCNT, playRandomBMI2, playRandomAVX2 };
+
+    getMoves = move_kernels[level];
+    selectBit = select_kernels[level];
+    playRandomGame = playout_kernels[level];
+}
@@ -1,6 +1,11 @@
+# ifndef BOARD_H
+# define BOARD_H
+
 # include <stdio.h>
 # include <stdlib.h>
 # include <stdint.h> 
+# include "rng.h"
+# include "cpu.h"
 
 // turns
 typedef enum 
@@ -40,15 +45,30 @@ typedef unsigned long long bitboard;
 // board struct
 // pieces -> pieces[0] is a bitboard of black pieces, pieces[1] is the same but for white
 // moves -> the available moves for the board
+// hash -> zobrist hash of the pieces and turn, kept up to date by makeMove
 // turn -> describes whose turn it is
 typedef struct board
 {
     bitboard pieces[2];
     bitboard moves;
+    bitboard hash;
     turn turn;
 } board;
 
 
+// move value of a pass
+# define PASS 64
+
+// converts a square to a bitboard with a single bit set, or none for a pass
+# define moveBit(m) ((m) == PASS ? 0ULL : 1ULL << (m))
+
+// converts a bitboard with at most one bit set to a square, or PASS
+# define bitMove(bb) ((bb) ? (uint8_t) __builtin_ctzll(bb) : PASS)
+
+// number of symmetries of the board, each a combination of a vertical flip
+// (bit 0), a horizontal mirror (bit 1) and a transpose (bit 2)
+# define SYMMETRIES 8
+
 // bitwise operation macros
 # define setBit(board, square) (board |= (1ULL << square))
 # define getBit(board, square) (board & (1ULL << square))
@@ -59,12 +79,36 @@ board *createBoard();
 
 board *cloneBoard(board *b);
 
+bitboard hashBoard(board *b);
+
 void printBoard(board *b);
 
 void deleteBoard(board *b);
 
 bitboard shift(bitboard bb, dir d);
 
-bitboard getMoves(board *b);
+extern bitboard (*getMoves)(board *b);
+
+int gameOver(board *b);
+
+extern bitboard (*selectBit)(bitboard bb, int index);
+
+bitboard getFlips(board *b, square sq);
+
+bitboard playMove(board *b, bitboard bb);
+
+extern void (*playRandomGame)(board *b, rng *r);
+
+void makeMove(board *b, bitboard bb);
+
+bitboard transformBits(bitboard bb, int sym);
+
+bitboard restoreBits(bitboard bb, int sym);
+
+bitboard canonicalHash(board *b, int *sym);
+
+bitboard distinctMoves(board *b);
+
+void useBoardKernels(isa level);
 
-void makeMove(board *b, bitboard bb);
\ No newline at end of file
+# endif
@@ -0,0 +1,120 @@
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "book.h"
+
+// maps a book file into memory, its pages are only read once looked up
+// path -> the file to open
+// returns -> the book, or NULL if the file is missing or not a book
+book *openBook(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(header))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // the mapping stays valid after the file is closed
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    const header *h = (const header *) map;
+    if (h->magic != BOOK_MAGIC || sizeof(header) + h->count * sizeof(record) > (size_t) st.st_size)
+    {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    book *bk = (book *) malloc(sizeof(book));
+    bk->map = map;
+    bk->size = st.st_size;
+    bk->records = (const record *) (h + 1);
+    bk->count = h->count;
+
+    return bk;
+}
+
+// unmaps a book
+// bk -> the book to close
+void closeBook(book *bk)
+{
+    munmap(bk->map, bk->size);
+    free(bk);
+}
+
+// looks a position up in the book
+// bk -> the book to search
+// b -> the position
+// rec -> if not NULL, filled with the record that was found
+// returns -> a bitboard with the book move set, or 0 if the position is not
+//            in the book
+bitboard findBookMove(book *bk, board *b, record *rec)
+{
+    int sym;
+    bitboard key = canonicalHash(b, &sym);
+
+    // binary search over the sorted records
+    size_t low = 0;
+    size_t high = bk->count;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (bk->records[mid].key < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    if (low == bk->count || bk->records[low].key != key || bk->records[low].move == PASS)
+    {
+        return 0;
+    }
+
+    // back to the orientation of the board, guarding against hash collisions
+    bitboard move = restoreBits(moveBit(bk->records[low].move), sym);
+    if (!(move & b->moves))
+    {
+        return 0;
+    }
+
+    if (rec)
+    {
+        *rec = bk->records[low];
+    }
+    return move;
+}
+
+// writes a book file
+// path -> the file to write
+// records -> the records, sorted by key with one record per key
+// count -> number of records
+// returns -> 0 on success, -1 if the file could not be written
+int writeBook(const char *path, record *records, size_t count)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    header h = { BOOK_MAGIC, (uint32_t) count };
+    int ok = fwrite(&h, sizeof(header), 1, file) == 1 && fwrite(records, sizeof(record), count, file) == count;
+
+    return fclose(file) == 0 && ok ? 0 : -1;
+}
@@ -0,0 +1,53 @@
+# ifndef BOOK_H
+# define BOOK_H
+
+# include "board.h"
+
+// first bytes of a book file, "BOOK" in little endian
+# define BOOK_MAGIC 0x4B4F4F42
+
+// book entry, for a position in its canonical orientation
+// key -> canonical hash of the position, see canonicalHash
+// move -> the square to play in the canonical orientation, or PASS
+// score -> mean final disc difference for the side to move after the move
+// games -> number of games the move was played in
+typedef struct
+{
+    bitboard key;
+    uint8_t move;
+    int8_t score;
+    uint16_t unused;
+    uint32_t games;
+} record;
+
+// start of a book file, followed by its records sorted by key
+// magic -> BOOK_MAGIC
+// count -> number of records
+typedef struct
+{
+    uint32_t magic;
+    uint32_t count;
+} header;
+
+// an opening book mapped into memory
+// map -> the mapped file
+// size -> the size of the mapping
+// records -> the records, sorted by key
+// count -> number of records
+typedef struct
+{
+    void *map;
+    size_t size;
+    const record *records;
+    size_t count;
+} book;
+
+book *openBook(const char *path);
+
+void closeBook(book *bk);
+
+bitboard findBookMove(book *bk, board *b, record *rec);
+
+int writeBook(const char *path, record *records, size_t count);
+
+# endif
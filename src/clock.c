@@ -0,0 +1,12 @@
+# include "clock.h"
+
+// reads a monotonic wall clock, which unlike clock() keeps the same pace no
+// matter how many threads are searching
+// returns -> the time in seconds
+double getClock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
@@ -0,0 +1,8 @@
+# ifndef CLOCK_H
+# define CLOCK_H
+
+# include <time.h>
+
+double getClock();
+
+# endif
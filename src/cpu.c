@@ -0,0 +1,99 @@
+# include <string.h>
+# include <cpuid.h>
+# include "cpu.h"
+# include "board.h"
+# include "tree.h"
+
+// names of the instruction set levels, as printed and parsed
+static const char *isa_names[isa_count] = { "baseline", "popcnt", "bmi2", "avx2" };
+
+// the level the kernels were picked for, baseline until initCPU runs
+isa cpu_isa = baseline_isa;
+
+// reads the extended control register 0, telling which register states the
+// os saves on a context switch
+// returns -> the register, or 0 if the os does not expose it
+static unsigned long long readXCR0()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE))
+    {
+        return 0;
+    }
+
+    unsigned int low, high;
+    __asm__ volatile ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+    return ((unsigned long long) high << 32) | low;
+}
+
+// finds the highest instruction set level the cpu supports
+// returns -> the level
+isa detectISA()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_POPCNT))
+    {
+        return baseline_isa;
+    }
+    int avx = (ecx & bit_AVX) != 0;
+
+    unsigned int ext_ecx = 0;
+    if (__get_cpuid(0x80000001, &eax, &ebx, &ext_ecx, &edx) == 0)
+    {
+        ext_ecx = 0;
+    }
+
+    if (__get_cpuid_max(0, NULL) < 7)
+    {
+        return popcnt_isa;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (!(ebx & bit_BMI) || !(ebx & bit_BMI2) || !(ext_ecx & bit_LZCNT))
+    {
+        return popcnt_isa;
+    }
+
+    // the os must save the ymm registers too
+    if (!(ebx & bit_AVX2) || !avx || (readXCR0() & 6) != 6)
+    {
+        return bmi2_isa;
+    }
+
+    return avx2_isa;
+}
+
+// picks the kernels of an instruction set level, to be called once at startup
+// before any search thread runs
+// level -> the level to use, lowered to what the cpu supports
+void initCPU(isa level)
+{
+    isa supported = detectISA();
+    cpu_isa = level < supported ? level : supported;
+
+    useBoardKernels(cpu_isa);
+    useTreeKernels(cpu_isa);
+}
+
+// names an instruction set level
+// level -> the level
+// returns -> its name
+const char *isaName(isa level)
+{
+    return isa_names[level];
+}
+
+// reads the name of an instruction set level
+// name -> the name
+// returns -> the level, or -1 if there is none by that name
+int parseISA(const char *name)
+{
+    for (int i = 0; i < isa_count; i++)
+    {
+        if (strcmp(name, isa_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,25 @@
+# ifndef CPU_H
+# define CPU_H
+
+// instruction set levels the hot kernels are built for, each level also
+// having everything of the levels before it
+// baseline_isa -> plain x86-64
+// popcnt_isa -> adds the popcnt instruction
+// bmi2_isa -> adds bmi1, bmi2 and lzcnt
+// avx2_isa -> adds avx2, with the os saving the vector registers
+typedef enum
+{
+    baseline_isa, popcnt_isa, bmi2_isa, avx2_isa, isa_count
+} isa;
+
+extern isa cpu_isa;
+
+isa detectISA();
+
+void initCPU(isa level);
+
+const char *isaName(isa level);
+
+int parseISA(const char *name);
+
+# endif
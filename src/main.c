@@ -3,7 +3,9 @@
 # include <unistd.h>
 # include <locale.h>
 
-# include "ai.h"
+# include "match.h"
+# include "analyze.h"
+# include "server.h"
 
 // prints the str representation of a move bitboard
 // bb -> bitboard with a single bit set for the move
@@ -54,16 +56,217 @@ bitboard processMove(board *b, AI *ai, char *str)
 int main(int argc, char const *argv[])
 {
     setlocale(LC_NUMERIC, "");
-    int seconds = 90;
+    config cfg = { .seconds = 90, .threads = 1, .shared = 0, .ponder = 0, .endgame = 20, .dump = NULL, .book = NULL, .snapshot = NULL, .seed = 0, .memory = 0, .playouts = 0, .nodes = 0 };
+
+    // self-play match, the second player only differing in its time
+    int games = 0;
+    int workers = countCores();
+    int opponent_seconds = 0;
+
+    // batch analysis of the positions in a file, with a playout, node or time
+    // budget
+    const char *positions = NULL;
+    int milliseconds = 0;
+
+    // many games over stdin, each line prefixed with its game id
+    int serve = 0;
+
+    // the highest instruction set the kernels may use, lowered to the cpu's
+    isa level = isa_count - 1;
+
+    // handle options
+    int opt;
+    while ((opt = getopt(argc, (char * const *) argv, "a:b:e:g:G:i:j:k:m:M:n:N:pr:sSt:w:")) != -1)
+    {
+        switch (opt)
+        {
+            // file of positions to analyze, - for stdin
+            case 'a':
+                positions = optarg;
+                break;
+
+            // opening book to play from
+            case 'b':
+                cfg.book = openBook(optarg);
+                if (!cfg.book)
+                {
+                    fprintf(stderr, "%s: %s is not an opening book\n", argv[0], optarg);
+                    return 1;
+                }
+                break;
+
+            // number of empty squares to solve exactly from
+            case 'e':
+                cfg.endgame = atoi(optarg);
+                break;
+
+            // number of self-play games to play instead of reading commands
+            case 'g':
+                games = atoi(optarg);
+                break;
+
+            // seconds of the second player in self-play games
+            case 'G':
+                opponent_seconds = atoi(optarg);
+                break;
+
+            // instruction set to pick the kernels for
+            case 'i':
+                if (parseISA(optarg) < 0)
+                {
+                    fprintf(stderr, "%s: %s is not an instruction set, use baseline, popcnt, bmi2 or avx2\n", argv[0], optarg);
+                    return 1;
+                }
+                level = parseISA(optarg);
+                break;
+
+            // file to keep the tree of the starting position in
+            case 'k':
+                cfg.snapshot = optarg;
+                break;
+
+            // milliseconds searched per analyzed position
+            case 'm':
+                milliseconds = atoi(optarg);
+                break;
+
+            // mebibytes the search trees may use
+            case 'M':
+                cfg.memory = (size_t) (atoi(optarg) > 0 ? atoi(optarg) : 0) << 20;
+                break;
+
+            // playouts searched per move or analyzed position
+            case 'n':
+                cfg.playouts = atoi(optarg) > 0 ? atoi(optarg) : 0;
+                break;
+
+            // tree nodes created per move or analyzed position
+            case 'N':
+                cfg.nodes = atoll(optarg) > 0 ? (uint64_t) atoll(optarg) : 0;
+                break;
+
+            // search while the opponent thinks
+            case 'p':
+                cfg.ponder = 1;
+                break;
+
+            // file to write the search counters to
+            case 'j':
+# ifndef STATS
+                fprintf(stderr, "%s: -j needs a build with STATS=1\n", argv[0]);
+                return 1;
+# endif
+                cfg.dump = fopen(optarg, "a");
+                if (!cfg.dump)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+
+            // seed of the search, the same seed and budget giving the same moves
+            case 'r':
+                cfg.seed = strtoull(optarg, NULL, 10);
+                break;
+
+            // search one tree with all threads
+            case 's':
+                cfg.shared = 1;
+                break;
+
+            // serve many games on one pool of workers
+            case 'S':
+                serve = 1;
+                break;
+
+            // number of search threads
+            case 't':
+                cfg.threads = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+
+            // number of games or positions searched at the same time
+            case 'w':
+                workers = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-a positions [-m milliseconds]] [-b book] [-e empties] [-g games [-G seconds] [-w workers]] [-i isa] [-j file] [-k file] [-M mebibytes] [-n playouts] [-N nodes] [-p] [-r seed] [-s] [-S [-w workers]] [-t threads] [seconds]\n", argv[0]);
+                return 1;
+        }
+    }
 
     // handle args
-    if (argc == 2 && atoi(argv[1]) != 0)
+    if (optind < argc && atoi(argv[optind]) != 0)
     {
-        seconds = atoi(argv[1]);    
+        cfg.seconds = atoi(argv[optind]);    
     }
+
+    // kernels are picked before any search thread runs
+    initCPU(level);
     
+    if (serve)
+    {
+        serveGames(&cfg, workers, stdin);
+
+        if (cfg.book)
+        {
+            closeBook(cfg.book);
+        }
+        return 0;
+    }
+
+    if (positions)
+    {
+        FILE *in = strcmp(positions, "-") ? fopen(positions, "r") : stdin;
+        if (!in)
+        {
+            perror(positions);
+            return 1;
+        }
+
+        // without a budget, search each position for a fixed number of playouts
+        analysis an = { .playouts = cfg.playouts, .nodes = cfg.nodes, .seconds = milliseconds / 1000.0, .workers = workers,
+            .seed = cfg.seed ? cfg.seed : (uint64_t) time(NULL) };
+        if (!an.playouts && !an.nodes && an.seconds <= 0)
+        {
+            an.playouts = ANALYZE_PLAYOUTS;
+        }
+
+        int errors = analyzePositions(&an, in);
+        if (in != stdin)
+        {
+            fclose(in);
+        }
+        return errors ? 1 : 0;
+    }
+
+    if (games > 0)
+    {
+        // the players only search on their own time and keep no files
+        match m = { .games = games, .workers = workers, .seed = cfg.seed ? cfg.seed : (uint64_t) time(NULL) };
+        cfg.ponder = 0;
+        cfg.dump = NULL;
+        cfg.snapshot = NULL;
+        m.players[0] = cfg;
+        m.players[1] = cfg;
+        if (opponent_seconds > 0)
+        {
+            m.players[1].seconds = opponent_seconds;
+        }
+
+        printf("match: %i games on %i workers, %is against %is, seed %llu\n", games, workers,
+            m.players[0].seconds, m.players[1].seconds, (unsigned long long) m.seed);
+        runMatch(&m);
+
+        if (cfg.book)
+        {
+            closeBook(cfg.book);
+        }
+        return 0;
+    }
+
     board *b = createBoard();
-    AI *ai = createAI(b, seconds);
+    AI *ai = createAI(b, &cfg);
 
     printf("C ╔═══╗ ╔╗ ╔╗      ╔╗ ╔╗         ╔══╗      ╔╗ \n");
     printf("C ║╔═╗║╔╝╚╗║║      ║║ ║║         ║╔╗║     ╔╝╚╗\n");
@@ -77,14 +280,37 @@ int main(int argc, char const *argv[])
     printf("C showTree ... true\n");
     printf("C showDebug .. true\n");
     printf("C\n");
-    printf("C sec/move ... %.2f\n", (double)seconds / 30);                                                     
+    printf("C sec/move ... %.2f\n", (double)cfg.seconds / 30);
+    if (cfg.playouts || cfg.nodes)
+    {
+        printf("C budget ..... %'u playouts, %'llu nodes\n", cfg.playouts, (unsigned long long) cfg.nodes);
+    }
+    if (cfg.seed)
+    {
+        printf("C seed ....... %llu\n", (unsigned long long) cfg.seed);
+    }                                                     
+    printf("C isa ........ %s\n", isaName(cpu_isa));
+    printf("C threads .... %i (%s)\n", cfg.threads, cfg.shared ? "shared tree" : "root parallel");
+    printf("C ponder ..... %s\n", cfg.ponder ? "true" : "false");
+    printf("C endgame .... %i empties\n", cfg.endgame);
+    printf("C memory ..... %'zu MiB\n", cfg.memory >> 20);
+    printf("C book ....... %'zu positions\n", cfg.book ? cfg.book->count : 0);
     printf("C Enter 'I B' or 'I W' to begin\n");
 
+    // the color the ai plays, or -1 before a game starts
+    int color = -1;
+
     while (1)
     {
         // get input
         char str[16];
-        fgets(str, sizeof(str), stdin);
+        if (!fgets(str, sizeof(str), stdin))
+        {
+            break;
+        }
+
+        // the opponent has answered, so the tree is needed again
+        stopPonder(ai);
 
         // parse input
         switch(str[0])
@@ -96,10 +322,15 @@ int main(int argc, char const *argv[])
                 deleteBoard(b);
                 destroyAI(ai);
                 b = createBoard();
-                ai = createAI(b, seconds);
+                ai = createAI(b, &cfg);
+                if (ai->loaded)
+                {
+                    printf("C Snapshot: resuming from %'u playouts\n", ai->loaded);
+                }
 
                 if (str[2] == 'B')
                 {
+                    color = black;
                     bitboard move = calcBestMove(ai);
                     makeMove(b, move);
 
@@ -108,15 +339,29 @@ int main(int argc, char const *argv[])
                     printf("R B\n");
                     printf("B");
                     printMove(move);
+                    fflush(stdout);
 
+                    // the reply is out, so the snapshot is saved on the
+                    // opponent's time
+                    saveAI(ai);
                     updateAI(ai, move);
 
                 }
                 else if (str[2] == 'W')
                 {
+                    color = white;
                     printBoard(b);
                     printf("R W\n");
-                    calcBestMove(ai);
+
+                    // pondering already covers the opponent's first move,
+                    // but the snapshot is searched and saved first, so that
+                    // it is not left to the reply
+                    if (!cfg.ponder || (cfg.snapshot && !ai->saved))
+                    {
+                        fflush(stdout);
+                        calcBestMove(ai);
+                        saveAI(ai);
+                    }
                 }
 
                 break;
@@ -162,9 +407,23 @@ int main(int argc, char const *argv[])
         }
 
         fflush(stdout);
+
+        // search on the opponent's time until their move arrives
+        if (cfg.ponder && b->turn != color && color != -1 && !gameOver(b))
+        {
+            startPonder(ai);
+        }
     }
 
     deleteBoard(b);
     destroyAI(ai);
+    if (cfg.dump)
+    {
+        fclose(cfg.dump);
+    }
+    if (cfg.book)
+    {
+        closeBook(cfg.book);
+    }
     return 0;
 }
\ No newline at end of file
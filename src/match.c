@@ -0,0 +1,139 @@
+# include "match.h"
+
+// plays one game of a match and records its result
+// games come in pairs with the same opening, the first player taking black
+// in even games and white in odd ones
+// m -> the match
+// game -> index of the game
+static void playGame(match *m, int game)
+{
+    rng r;
+    seedRandom(&r, m->seed + game / 2);
+
+    board *b = createBoard();
+    char opening[2 * MATCH_PLIES + 1] = "";
+
+    for (int i = 0; i < MATCH_PLIES && b->moves; i++)
+    {
+        bitboard move = selectBit(b->moves, randomBelow(&r, __builtin_popcountll(b->moves)));
+        square sq = bitMove(move);
+        sprintf(opening + 2 * i, "%c%c", 'a' + sq % 8, '1' + sq / 8);
+        makeMove(b, move);
+    }
+
+    // player index of each color
+    int first = game % 2 == 0 ? black : white;
+    int colors[2] = { first == black ? 0 : 1, first == black ? 1 : 0 };
+
+    AI *ais[2];
+    uint64_t playouts[2] = { 0, 0 };
+    uint64_t moves[2] = { 0, 0 };
+    for (int p = 0; p < 2; p++)
+    {
+        config cfg = m->players[p];
+        cfg.seed = mixSeed(mixSeed(m->seed, game), p);
+        ais[p] = createAI(b, &cfg);
+    }
+
+    while (!gameOver(b))
+    {
+        int p = colors[b->turn];
+        bitboard move = 0ULL;
+        if (b->moves)
+        {
+            move = calcBestMove(ais[p]);
+            if (ais[p]->playouts)
+            {
+                playouts[p] += ais[p]->playouts;
+                moves[p]++;
+            }
+        }
+
+        makeMove(b, move);
+        updateAI(ais[0], move);
+        updateAI(ais[1], move);
+    }
+
+    int diff = __builtin_popcountll(b->pieces[first]) - __builtin_popcountll(b->pieces[first ^ 1]);
+
+    pthread_mutex_lock(&m->lock);
+    m->wins += diff > 0;
+    m->draws += diff == 0;
+    m->losses += diff < 0;
+    m->discs += diff;
+    for (int p = 0; p < 2; p++)
+    {
+        m->playouts[p] += playouts[p];
+        m->moves[p] += moves[p];
+    }
+    printf("game %i: %s as %s, opening %s, %+i discs\n", game + 1, diff > 0 ? "win" : diff < 0 ? "loss" : "draw",
+        first == black ? "black" : "white", opening, diff);
+    fflush(stdout);
+    pthread_mutex_unlock(&m->lock);
+
+    destroyAI(ais[0]);
+    destroyAI(ais[1]);
+    deleteBoard(b);
+}
+
+// plays games of a match until none are left
+// arg -> the match
+// returns -> NULL
+static void *playGames(void *arg)
+{
+    match *m = (match *) arg;
+
+    int game;
+    while ((game = __atomic_fetch_add(&m->next, 1, __ATOMIC_RELAXED)) < m->games)
+    {
+        playGame(m, game);
+    }
+
+    return NULL;
+}
+
+// plays every game of a match on a pool of workers, printing each result and
+// then the first player's score with its 95% confidence interval
+// m -> the match, with its players, games, workers and seed set
+void runMatch(match *m)
+{
+    m->next = 0;
+    m->wins = m->draws = m->losses = m->discs = 0;
+    m->playouts[0] = m->playouts[1] = 0;
+    m->moves[0] = m->moves[1] = 0;
+    pthread_mutex_init(&m->lock, NULL);
+
+    double start = getClock();
+
+    int workers = m->workers < m->games ? m->workers : m->games;
+    pthread_t *ids = (pthread_t *) malloc(sizeof(pthread_t) * workers);
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_create(&ids[i], NULL, playGames, m);
+    }
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_join(ids[i], NULL);
+    }
+    free(ids);
+
+    pthread_mutex_destroy(&m->lock);
+
+    // each game scores 1, 1/2 or 0, so the interval follows from their spread
+    int n = m->wins + m->draws + m->losses;
+    double score = n ? (m->wins + 0.5 * m->draws) / n : 0;
+    double spread = n ? sqrt((m->wins + 0.25 * m->draws) / n - score * score) : 0;
+    double error = n ? 1.96 * spread / sqrt(n) : 0;
+
+    printf("games: %i, %i wins, %i draws, %i losses in %.1fs\n", n, m->wins, m->draws, m->losses, getClock() - start);
+    printf("score: %.1f%% +- %.1f%%, %+.2f discs per game\n", 100 * score, 100 * error, n ? (double) m->discs / n : 0);
+    if (score > 0 && score < 1)
+    {
+        printf("elo: %+.0f\n", 400 * log10(score / (1 - score)));
+    }
+    for (int p = 0; p < 2; p++)
+    {
+        printf("player %i: %'llu playouts per searched move\n", p + 1,
+            (unsigned long long) (m->moves[p] ? m->playouts[p] / m->moves[p] : 0));
+    }
+}
@@ -0,0 +1,41 @@
+# ifndef MATCH_H
+# define MATCH_H
+
+# include "ai.h"
+
+// number of random moves each pair of games opens with
+# define MATCH_PLIES 4
+
+// a match between two players, each game on its own worker thread
+// players -> the settings of the two players, the first being the one scored
+// games -> number of games to play, the colors alternating between games
+// workers -> number of games played at the same time
+// seed -> seed of the match, each opening and each player of every game
+//         getting a seed derived from it
+// next -> index of the next game to hand to a worker
+// wins -> games won by the first player
+// draws -> games drawn
+// losses -> games lost by the first player
+// discs -> disc difference summed over the games, for the first player
+// playouts -> playouts run by each player over all its searched moves
+// moves -> number of moves each player searched
+// lock -> guards the results and the output
+typedef struct
+{
+    config players[2];
+    int games;
+    int workers;
+    uint64_t seed;
+    int next;
+    int wins;
+    int draws;
+    int losses;
+    int discs;
+    uint64_t playouts[2];
+    uint64_t moves[2];
+    pthread_mutex_t lock;
+} match;
+
+void runMatch(match *m);
+
+# endif
@@ -0,0 +1,138 @@
+# include "reclaim.h"
+# include "clock.h"
+
+// number of items the queue starts with room for
+# define RECLAIM_START 64
+
+// releases queued subtrees until stopped
+// arg -> the reclaimer
+// returns -> NULL
+static void *runReclaimer(void *arg)
+{
+    reclaimer *rc = (reclaimer *) arg;
+
+    pthread_mutex_lock(&rc->lock);
+    while (1)
+    {
+        while (!rc->count && !rc->stop)
+        {
+            pthread_cond_wait(&rc->wake, &rc->lock);
+        }
+        if (rc->stop)
+        {
+            break;
+        }
+
+        garbage item = rc->items[rc->head];
+        rc->head = (rc->head + 1) & (rc->size - 1);
+        rc->count--;
+        rc->busy = 1;
+        pthread_mutex_unlock(&rc->lock);
+
+        double start = getClock();
+        releaseNodes(item.tr, item.bl);
+        double seconds = getClock() - start;
+
+        pthread_mutex_lock(&rc->lock);
+        rc->busy = 0;
+        rc->seconds += seconds;
+        if (!rc->count)
+        {
+            pthread_cond_broadcast(&rc->idle);
+        }
+    }
+    pthread_mutex_unlock(&rc->lock);
+
+    return NULL;
+}
+
+// creates a reclaimer and starts its thread
+// returns -> the new reclaimer
+reclaimer *createReclaimer()
+{
+    reclaimer *rc = (reclaimer *) malloc(sizeof(reclaimer));
+    rc->items = (garbage *) malloc(RECLAIM_START * sizeof(garbage));
+    rc->head = 0;
+    rc->count = 0;
+    rc->size = RECLAIM_START;
+    rc->busy = 0;
+    rc->stop = 0;
+    rc->seconds = 0;
+    pthread_mutex_init(&rc->lock, NULL);
+    pthread_cond_init(&rc->wake, NULL);
+    pthread_cond_init(&rc->idle, NULL);
+
+    pthread_create(&rc->id, NULL, runReclaimer, rc);
+
+    return rc;
+}
+
+// stops a reclaimer once it finishes the subtree it is releasing, the
+// subtrees still queued being left to their trees' arenas
+// rc -> the reclaimer to delete
+void deleteReclaimer(reclaimer *rc)
+{
+    pthread_mutex_lock(&rc->lock);
+    rc->stop = 1;
+    pthread_cond_signal(&rc->wake);
+    pthread_mutex_unlock(&rc->lock);
+
+    pthread_join(rc->id, NULL);
+
+    pthread_mutex_destroy(&rc->lock);
+    pthread_cond_destroy(&rc->wake);
+    pthread_cond_destroy(&rc->idle);
+    free(rc->items);
+    free(rc);
+}
+
+// queues a discarded subtree to be released in the background
+// rc -> the reclaimer
+// tr -> the tree the subtree belongs to
+// bl -> the block at the top of the subtree, holding one reference for it
+void reclaimBlock(reclaimer *rc, tree *tr, block *bl)
+{
+    pthread_mutex_lock(&rc->lock);
+    if (rc->count == rc->size)
+    {
+        garbage *items = (garbage *) malloc(2 * rc->size * sizeof(garbage));
+        for (size_t i = 0; i < rc->count; i++)
+        {
+            items[i] = rc->items[(rc->head + i) & (rc->size - 1)];
+        }
+        free(rc->items);
+        rc->items = items;
+        rc->head = 0;
+        rc->size *= 2;
+    }
+
+    rc->items[(rc->head + rc->count) & (rc->size - 1)] = (garbage) { tr, bl };
+    rc->count++;
+    pthread_cond_signal(&rc->wake);
+    pthread_mutex_unlock(&rc->lock);
+}
+
+// waits until every queued subtree has been released
+// rc -> the reclaimer
+void waitReclaimer(reclaimer *rc)
+{
+    pthread_mutex_lock(&rc->lock);
+    while (rc->count || rc->busy)
+    {
+        pthread_cond_wait(&rc->idle, &rc->lock);
+    }
+    pthread_mutex_unlock(&rc->lock);
+}
+
+// reads and resets the time spent releasing subtrees
+// rc -> the reclaimer
+// returns -> seconds spent since the last call
+double takeReclaimTime(reclaimer *rc)
+{
+    pthread_mutex_lock(&rc->lock);
+    double seconds = rc->seconds;
+    rc->seconds = 0;
+    pthread_mutex_unlock(&rc->lock);
+
+    return seconds;
+}
@@ -0,0 +1,52 @@
+# ifndef RECLAIM_H
+# define RECLAIM_H
+
+# include "tree.h"
+
+// a subtree waiting to be released
+// tr -> the tree it belongs to
+// bl -> the block at its top
+typedef struct
+{
+    tree *tr;
+    block *bl;
+} garbage;
+
+// background thread releasing discarded subtrees, so re-rooting returns at once
+// id -> the thread
+// items -> ring buffer of subtrees waiting to be released
+// head -> index of the first item
+// count -> number of items
+// size -> number of items there is room for, a power of two
+// busy -> whether the thread is releasing an item
+// stop -> set to end the thread, dropping the items left
+// seconds -> time spent releasing since the last call to takeReclaimTime
+// lock -> guards everything but the thread id
+// wake -> signaled when items are added or the thread should stop
+// idle -> signaled when the thread runs out of items
+typedef struct
+{
+    pthread_t id;
+    garbage *items;
+    size_t head;
+    size_t count;
+    size_t size;
+    int busy;
+    int stop;
+    double seconds;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+} reclaimer;
+
+reclaimer *createReclaimer();
+
+void deleteReclaimer(reclaimer *rc);
+
+void reclaimBlock(reclaimer *rc, tree *tr, block *bl);
+
+void waitReclaimer(reclaimer *rc);
+
+double takeReclaimTime(reclaimer *rc);
+
+# endif
@@ -0,0 +1,31 @@
+# include "rng.h"
+
+// seeds a generator, expanding the seed with splitmix64 so that similar seeds
+// still give unrelated streams
+// r -> the generator to seed
+// seed -> any 64 bit value
+void seedRandom(rng *r, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        r->s[i] = z ^ (z >> 31);
+    }
+}
+
+// hashes a seed and a stream number into the seed of that stream with the
+// splitmix64 finalizer, so that nearby seeds derived from it, such as those
+// of an ai's threads, do not run into those of other streams
+// seed -> any 64 bit value
+// stream -> the number of the stream
+// returns -> the stream's seed, never 0 as that seeds an ai from the clock
+uint64_t mixSeed(uint64_t seed, uint64_t stream)
+{
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
@@ -0,0 +1,48 @@
+# ifndef RNG_H
+# define RNG_H
+
+# include <stdint.h>
+
+// xoshiro256** generator state, owned by a search so that no locks are shared
+// between searches and a seed reproduces the same random stream
+//
+// https://prng.di.unimi.it/
+typedef struct
+{
+    uint64_t s[4];
+} rng;
+
+void seedRandom(rng *r, uint64_t seed);
+
+uint64_t mixSeed(uint64_t seed, uint64_t stream);
+
+// gets the next 64 random bits
+// r -> the generator to advance
+// returns -> the random bits
+static inline uint64_t nextRandom(rng *r)
+{
+    uint64_t *s = r->s;
+    uint64_t result = s[1] * 5;
+    result = ((result << 7) | (result >> 57)) * 9;
+
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return result;
+}
+
+// gets a random number below a bound, using a multiply instead of a division
+// r -> the generator to advance
+// n -> the exclusive upper bound
+// returns -> a number in [0, n)
+static inline uint32_t randomBelow(rng *r, uint32_t n)
+{
+    return (uint32_t) (((nextRandom(r) >> 32) * n) >> 32);
+}
+
+# endif
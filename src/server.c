@@ -0,0 +1,382 @@
+# include <string.h>
+# include "server.h"
+
+// rounds a game searches in one slice before the next game gets a turn
+# define SLICE_ROUNDS 256
+
+// finds the bucket of a game id with an fnv-1a hash
+// id -> the game id
+// returns -> index of the bucket
+static int bucketOf(const char *id)
+{
+    uint32_t h = 2166136261u;
+    for (; *id; id++)
+    {
+        h = (h ^ (uint8_t) *id) * 16777619u;
+    }
+
+    return h % SERVER_BUCKETS;
+}
+
+// finds an open game
+// sv -> the server
+// id -> the game id
+// returns -> the game, or NULL if there is none by that id
+static session *findSession(server *sv, const char *id)
+{
+    for (session *s = sv->buckets[bucketOf(id)]; s; s = s->chained)
+    {
+        if (strcmp(s->id, id) == 0)
+        {
+            return s;
+        }
+    }
+
+    return NULL;
+}
+
+// frees a game that has been unlinked from the buckets
+// run on the pool, as destroying an ai waits for the shared reclaimer to
+// release the discarded subtrees of every game
+// arg -> the game
+static void deleteSession(void *arg)
+{
+    session *s = (session *) arg;
+    destroyAI(s->ai);
+    deleteBoard(s->b);
+    free(s);
+}
+
+// prints the move of a game's engine
+// s -> the game
+// move -> a bitboard with one bit set for the move, or no bits for a pass
+static void printReply(session *s, bitboard move)
+{
+    char side = s->color == black ? 'B' : 'W';
+    if (!move)
+    {
+        printf("%s %c\n", s->id, side);
+    }
+    else
+    {
+        square sq = bitMove(move);
+        printf("%s %c %c %d\n", s->id, side, 'a' + sq % 8, sq / 8 + 1);
+    }
+    fflush(stdout);
+}
+
+static void runSlice(void *arg);
+
+// puts a game in the slice queue, behind every game due no later, and adds
+// a slice to the pool
+// whichever worker runs the slice takes the game at the front, so games
+// get their slices earliest deadline first however the pool orders its
+// tasks, and games due at the same time take turns
+// sv -> the server
+// s -> the game
+static void queueSlice(server *sv, session *s)
+{
+    pthread_mutex_lock(&sv->lock);
+    session **link = &sv->head;
+    while (*link && (*link)->due <= s->due)
+    {
+        link = &(*link)->queued;
+    }
+    s->queued = *link;
+    *link = s;
+    pthread_mutex_unlock(&sv->lock);
+
+    submitTask(sv->workers, (task) { runSlice, sv });
+}
+
+// searches one slice of the game at the front of the slice queue, then
+// either plays its move or queues it again
+// a game closed while searching is freed instead
+// arg -> the server
+static void runSlice(void *arg)
+{
+    server *sv = (server *) arg;
+
+    pthread_mutex_lock(&sv->lock);
+    session *s = sv->head;
+    sv->head = s->queued;
+    int closing = s->closing;
+    pthread_mutex_unlock(&sv->lock);
+
+    if (closing)
+    {
+        deleteSession(s);
+        return;
+    }
+
+    // the first slice also settles single, book and solved moves, and sets
+    // the deadline the game is queued by
+    bitboard move = 0ULL;
+    int done = 0;
+    if (!s->begun)
+    {
+        s->begun = 1;
+        done = beginMove(s->ai, s->asked, &move);
+        s->due = s->ai->deadline;
+    }
+    if (!done && stepMove(s->ai, SLICE_ROUNDS))
+    {
+        move = endMove(s->ai);
+        done = 1;
+    }
+
+    if (!done)
+    {
+        queueSlice(sv, s);
+        return;
+    }
+
+    makeMove(s->b, move);
+    updateAI(s->ai, move);
+
+    pthread_mutex_lock(&sv->lock);
+    closing = s->closing;
+    if (!closing)
+    {
+        printReply(s, move);
+        s->searching = 0;
+    }
+    pthread_mutex_unlock(&sv->lock);
+
+    if (closing)
+    {
+        deleteSession(s);
+    }
+}
+
+// has a game's engine work out its move on the pool
+// sv -> the server
+// s -> the game, with the engine to move
+static void startSession(server *sv, session *s)
+{
+    pthread_mutex_lock(&sv->lock);
+    s->searching = 1;
+    s->begun = 0;
+    s->asked = getClock();
+    s->due = s->asked;
+    pthread_mutex_unlock(&sv->lock);
+
+    queueSlice(sv, s);
+}
+
+// ends a game, handing it to the pool to be freed or, while its engine is
+// still searching, leaving it to its next slice, so the reading thread
+// never waits
+// sv -> the server
+// s -> the game
+static void closeSession(server *sv, session *s)
+{
+    session **link = &sv->buckets[bucketOf(s->id)];
+    while (*link != s)
+    {
+        link = &(*link)->chained;
+    }
+    *link = s->chained;
+
+    pthread_mutex_lock(&sv->lock);
+    int searching = s->searching;
+    s->closing = 1;
+    pthread_mutex_unlock(&sv->lock);
+
+    if (!searching)
+    {
+        submitTask(sv->workers, (task) { deleteSession, s });
+    }
+}
+
+// starts a game, or restarts it if the id is already open, a search still
+// running for the old game being dropped
+// sv -> the server
+// id -> the game id
+// color -> the color the engine plays
+static void openSession(server *sv, const char *id, int color)
+{
+    session *s = findSession(sv, id);
+    if (s)
+    {
+        closeSession(sv, s);
+    }
+
+    s = (session *) malloc(sizeof(session));
+    strcpy(s->id, id);
+    s->searching = 0;
+    s->closing = 0;
+    s->chained = sv->buckets[bucketOf(id)];
+    sv->buckets[bucketOf(id)] = s;
+
+    s->b = createBoard();
+    s->ai = createAI(s->b, &sv->cfg);
+    s->color = color;
+
+    pthread_mutex_lock(&sv->lock);
+    printf("%s R %c\n", id, color == black ? 'B' : 'W');
+    fflush(stdout);
+    pthread_mutex_unlock(&sv->lock);
+
+    if (color == black)
+    {
+        startSession(sv, s);
+    }
+}
+
+// plays the opponent's move in a game and has the engine answer it
+// sv -> the server
+// s -> the game
+// cmd -> the move, as "B d 3", or "B" for a pass
+// returns -> 0 on success, -1 if it is not the opponent's legal move, or if
+//            the engine has not answered the last move yet
+static int playSession(server *sv, session *s, const char *cmd)
+{
+    pthread_mutex_lock(&sv->lock);
+    int searching = s->searching;
+    pthread_mutex_unlock(&sv->lock);
+    if (searching)
+    {
+        return -1;
+    }
+
+    int color = cmd[0] == 'B' ? black : white;
+    if (s->b->turn != color || color == s->color)
+    {
+        return -1;
+    }
+
+    // anything after the color is the square, nothing at all a pass
+    bitboard move = 0ULL;
+    char file;
+    int rank;
+    int fields = sscanf(cmd + 1, " %c %d", &file, &rank);
+    if (fields == 2 && file >= 'a' && file <= 'h' && rank >= 1 && rank <= 8)
+    {
+        move = 1ULL << ((rank - 1) * 8 + file - 'a');
+    }
+    else if (fields != EOF)
+    {
+        return -1;
+    }
+    if (move ? !(move & s->b->moves) : s->b->moves != 0)
+    {
+        return -1;
+    }
+
+    makeMove(s->b, move);
+    updateAI(s->ai, move);
+
+    // a finished game is answered with a pass, as in the single game
+    // protocol, without a slice
+    if (gameOver(s->b))
+    {
+        pthread_mutex_lock(&sv->lock);
+        printReply(s, 0ULL);
+        pthread_mutex_unlock(&sv->lock);
+        return 0;
+    }
+
+    startSession(sv, s);
+    return 0;
+}
+
+// plays many games at once, reading commands of the single game protocol
+// each prefixed with a game id, such as "g1 I B" or "g1 W c 4", and writing
+// the engines' replies prefixed the same way
+// "I" starts or restarts a game and "Q" closes it, dropping a search still
+// running, and a move sent before the engine's reply is rejected, so that
+// no command waits on a game's search
+// every game searches one tree, and pondering, snapshots and counter dumps
+// are turned off
+// cfg -> the settings every game's ai is created with
+// workers -> number of threads searching the games
+// in -> the stream of commands, one per line
+void serveGames(config *cfg, int workers, FILE *in)
+{
+    server *sv = (server *) malloc(sizeof(server));
+    sv->cfg = *cfg;
+    sv->cfg.threads = 1;
+    sv->cfg.shared = 0;
+    sv->cfg.ponder = 0;
+    sv->cfg.dump = NULL;
+    sv->cfg.snapshot = NULL;
+    sv->reclaimer = createReclaimer();
+    sv->cfg.reclaimer = sv->reclaimer;
+    sv->workers = createPool(workers);
+    memset(sv->buckets, 0, sizeof(sv->buckets));
+    sv->head = NULL;
+    pthread_mutex_init(&sv->lock, NULL);
+
+    char str[64];
+    for (size_t line = 1; fgets(str, sizeof(str), in); line++)
+    {
+        char id[SESSION_ID];
+        int length;
+        if (sscanf(str, "%31s %n", id, &length) != 1)
+        {
+            continue;
+        }
+
+        const char *cmd = str + length;
+        session *s = findSession(sv, id);
+        int error = 0;
+        switch (cmd[0])
+        {
+            // start a game
+            case 'I':
+                if (cmd[1] == ' ' && (cmd[2] == 'B' || cmd[2] == 'W'))
+                {
+                    openSession(sv, id, cmd[2] == 'B' ? black : white);
+                }
+                else
+                {
+                    error = 1;
+                }
+                break;
+
+            // move from the opponent
+            case 'B':
+            case 'W':
+                error = !s || playSession(sv, s, cmd) < 0;
+                break;
+
+            // close a game
+            case 'Q':
+                if (s)
+                {
+                    closeSession(sv, s);
+                }
+                break;
+
+            // ignore comments
+            case 'C':
+            default:
+                break;
+        }
+
+        if (error)
+        {
+            pthread_mutex_lock(&sv->lock);
+            fprintf(stderr, "line %zu: not a command of game %s\n", line, id);
+            pthread_mutex_unlock(&sv->lock);
+        }
+    }
+
+    // let the engines still searching answer
+    waitPool(sv->workers, 0);
+
+    for (int i = 0; i < SERVER_BUCKETS; i++)
+    {
+        while (sv->buckets[i])
+        {
+            closeSession(sv, sv->buckets[i]);
+        }
+    }
+    waitPool(sv->workers, 0);
+
+    deletePool(sv->workers);
+    deleteReclaimer(sv->reclaimer);
+    pthread_mutex_destroy(&sv->lock);
+    free(sv);
+}
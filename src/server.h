@@ -0,0 +1,64 @@
+# ifndef SERVER_H
+# define SERVER_H
+
+# include "ai.h"
+# include "workers.h"
+
+// number of hash buckets the games are spread over
+# define SERVER_BUCKETS 256
+
+// longest game id, including its terminator
+# define SESSION_ID 32
+
+// a game hosted by the server
+// id -> the name the client gave the game, starting every line about it
+// b -> the game state
+// ai -> the engine playing the game
+// color -> the color the engine plays
+// searching -> whether the engine is working out a move on the pool
+// begun -> whether the move's search has been started
+// closing -> whether the game was closed while searching, to be freed by
+//            its next slice
+// asked -> when the engine was asked for its move, its clock running from
+//          then
+// due -> when the move's search ends, or when the move was asked for before
+//        the search has been started
+// queued -> the next game waiting for a slice
+// chained -> the next game in the same bucket
+typedef struct session
+{
+    char id[SESSION_ID];
+    board *b;
+    AI *ai;
+    int color;
+    int searching;
+    int begun;
+    int closing;
+    double asked;
+    double due;
+    struct session *queued;
+    struct session *chained;
+} session;
+
+// many games played over one stream, their searches cut into slices of
+// rounds that take turns on one pool of workers
+// cfg -> the settings every game's ai is created with
+// workers -> the pool running the slices
+// reclaimer -> releases the discarded subtrees of every game
+// buckets -> the open games by hash of their ids
+// head -> the game waiting for a slice that is due first, or NULL
+// lock -> guards the slice queue, the searching and closing flags and the
+//         output
+typedef struct
+{
+    config cfg;
+    pool *workers;
+    reclaimer *reclaimer;
+    session *buckets[SERVER_BUCKETS];
+    session *head;
+    pthread_mutex_t lock;
+} server;
+
+void serveGames(config *cfg, int workers, FILE *in);
+
+# endif
@@ -0,0 +1,337 @@
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "snapshot.h"
+
+// blocks of a tree in the order they are written
+// blocks -> the blocks, the root's children first
+// count -> number of blocks
+// size -> number of blocks there is room for
+// slots -> open addressed map from block address to one more than its
+//          index, as blocks whose keys collide are kept apart
+// slot_count -> number of slots, a power of two
+typedef struct
+{
+    block **blocks;
+    size_t count;
+    size_t size;
+    uint32_t *slots;
+    size_t slot_count;
+} order;
+
+// blocks of a snapshot being loaded
+// spans -> the blocks in the file
+// edges -> the children in the file
+// count -> number of blocks
+// firsts -> index of the first edge of each block
+// blocks -> the blocks created for each span
+// filled -> whether each block's children have been set up
+// failed -> set if the file does not describe a tree of the root
+typedef struct
+{
+    const span *spans;
+    const edge *edges;
+    uint32_t count;
+    uint32_t *firsts;
+    block **blocks;
+    uint8_t *filled;
+    int failed;
+} loader;
+
+// finds the slot of a block in an order
+// o -> the order to search
+// bl -> the block
+// returns -> the slot holding the block, or the empty slot it belongs in
+static uint32_t *findSlot(order *o, block *bl)
+{
+    size_t mask = o->slot_count - 1;
+    size_t i = ((uintptr_t) bl >> 4) * 0x9E3779B97F4A7C15ULL >> 32 & mask;
+    while (o->slots[i] && o->blocks[o->slots[i] - 1] != bl)
+    {
+        i = (i + 1) & mask;
+    }
+    return &o->slots[i];
+}
+
+// adds a block and every block below it to an order, each only once
+// o -> the order to add to
+// bl -> the block to add
+static void listBlocks(order *o, block *bl)
+{
+    uint32_t *slot = findSlot(o, bl);
+    if (*slot)
+    {
+        return;
+    }
+
+    if (o->count == o->size)
+    {
+        o->size *= 2;
+        o->blocks = (block **) realloc(o->blocks, o->size * sizeof(block *));
+    }
+
+    o->blocks[o->count++] = bl;
+    *slot = o->count;
+
+    // the slots stay at most half full
+    if (2 * o->count > o->slot_count)
+    {
+        free(o->slots);
+        o->slot_count *= 2;
+        o->slots = (uint32_t *) calloc(o->slot_count, sizeof(uint32_t));
+        for (size_t i = 0; i < o->count; i++)
+        {
+            *findSlot(o, o->blocks[i]) = i + 1;
+        }
+    }
+
+    for (int i = 0; i < bl->child_count; i++)
+    {
+        if (bl->nodes[i].next)
+        {
+            listBlocks(o, bl->nodes[i].next);
+        }
+    }
+}
+
+// writes the tree under the root to a file, which must not be searched
+// while it is saved
+// tr -> the tree to save
+// path -> the file to write
+// returns -> 0 on success, -1 if the file could not be written
+int saveTree(tree *tr, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    order o = { (block **) malloc(1024 * sizeof(block *)), 0, 1024, (uint32_t *) calloc(2048, sizeof(uint32_t)), 2048 };
+    if (tr->root.next)
+    {
+        listBlocks(&o, tr->root.next);
+    }
+
+    snapshot s = { SNAPSHOT_MAGIC, (uint32_t) o.count, 0, tr->root.b.turn, { tr->root.b.pieces[0], tr->root.b.pieces[1] }, tr->wins, tr->plays };
+    for (size_t i = 0; i < o.count; i++)
+    {
+        s.edge_count += o.blocks[i]->child_count;
+    }
+
+    int ok = fwrite(&s, sizeof(snapshot), 1, file) == 1;
+
+    for (size_t i = 0; ok && i < o.count; i++)
+    {
+        span sp = { o.blocks[i]->key, (uint16_t) o.blocks[i]->node_count, (uint16_t) o.blocks[i]->child_count, (uint32_t) o.blocks[i]->sym };
+        ok = fwrite(&sp, sizeof(span), 1, file) == 1;
+    }
+
+    for (size_t i = 0; ok && i < o.count; i++)
+    {
+        block *bl = o.blocks[i];
+        for (int j = 0; ok && j < bl->child_count; j++)
+        {
+            node *nn = &bl->nodes[j];
+            edge e = { bl->wins[j], bl->plays[j], nn->next ? (int32_t) *findSlot(&o, nn->next) - 1 : -1, nn->move, { 0 } };
+            ok = fwrite(&e, sizeof(edge), 1, file) == 1;
+        }
+    }
+
+    free(o.blocks);
+    free(o.slots);
+
+    return fclose(file) == 0 && ok ? 0 : -1;
+}
+
+// sets up the children of a loaded block and every block below it
+// ld -> the snapshot being loaded
+// index -> the span of the block
+// parent -> the position the children are created from
+static void fillBlock(loader *ld, uint32_t index, board *parent)
+{
+    block *bl = ld->blocks[index];
+    const edge *edges = &ld->edges[ld->firsts[index]];
+    int sym = ld->spans[index].sym;
+
+    ld->filled[index] = 1;
+    if (sym >= SYMMETRIES || bl->key != positionKey(parent, &bl->sym))
+    {
+        ld->failed = 1;
+        return;
+    }
+
+    // the children are rebuilt in the orientation they were saved in, which
+    // later blocks below them were keyed by
+    board creator = *parent;
+    if (sym != bl->sym)
+    {
+        for (int color = 0; color < 2; color++)
+        {
+            creator.pieces[color] = restoreBits(transformBits(parent->pieces[color], bl->sym), sym);
+        }
+        creator.moves = getMoves(&creator);
+        creator.hash = hashBoard(&creator);
+        bl->sym = sym;
+    }
+
+    // the moves without an edge stay untried
+    addChildren(bl, &creator);
+    int child_count = ld->spans[index].child_count;
+    if (__builtin_popcountll(bl->untried) != bl->node_count)
+    {
+        ld->failed = 1;
+        return;
+    }
+
+    for (int i = 0; i < child_count && !ld->failed; i++)
+    {
+        const edge *e = &edges[i];
+        bitboard move = moveBit(e->move);
+        bitboard claimed = creator.moves ? move : bl->untried;
+
+        // the children must be distinct moves of the position, each played
+        // and won by at most 64 discs a play
+        if (e->move > PASS || (move && !creator.moves) || !(claimed & bl->untried) || !e->plays || e->wins > 64ULL * e->plays
+            || e->next < -1 || e->next >= (int32_t) ld->count)
+        {
+            ld->failed = 1;
+            return;
+        }
+        bl->untried &= ~claimed;
+        bl->child_count++;
+
+        node *nn = &bl->nodes[i];
+        nn->b = creator;
+        nn->move = e->move;
+        makeMove(&nn->b, move);
+        nn->next = e->next < 0 ? NULL : ld->blocks[e->next];
+
+        bl->wins[i] = e->wins;
+        bl->plays[i] = e->plays;
+        bl->sim_count += e->plays > 0;
+
+        if (nn->next)
+        {
+            nn->next->refs++;
+            if (!ld->filled[e->next])
+            {
+                fillBlock(ld, e->next, &nn->b);
+            }
+        }
+    }
+}
+
+// loads a snapshot into a tree that has not been searched yet, all blocks
+// coming from the tree's arena
+// tr -> the tree to load into
+// path -> the file to read
+// returns -> 0 on success, -1 if the file is missing, damaged, or was saved
+//            from a different root position
+int loadTree(tree *tr, const char *path)
+{
+    if (tr->root.next)
+    {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(snapshot))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const snapshot *s = (const snapshot *) map;
+    board *root = &tr->root.b;
+    if (s->magic != SNAPSHOT_MAGIC
+        || sizeof(snapshot) + (size_t) s->span_count * sizeof(span) + (size_t) s->edge_count * sizeof(edge) != (size_t) st.st_size
+        || s->pieces[0] != root->pieces[0] || s->pieces[1] != root->pieces[1] || s->turn != root->turn)
+    {
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    loader ld;
+    ld.spans = (const span *) (s + 1);
+    ld.edges = (const edge *) (ld.spans + s->span_count);
+    ld.count = s->span_count;
+    ld.firsts = (uint32_t *) malloc((ld.count + 1) * sizeof(uint32_t));
+    ld.blocks = (block **) malloc((ld.count + 1) * sizeof(block *));
+    ld.filled = (uint8_t *) calloc(ld.count + 1, 1);
+    ld.failed = 0;
+
+    // create every block up front, so children can point to any of them
+    uint64_t edges = 0;
+    uint32_t created = 0;
+    for (; created < ld.count; created++)
+    {
+        const span *sp = &ld.spans[created];
+        if (sp->node_count == 0 || sp->node_count > PASS || sp->child_count > sp->node_count)
+        {
+            ld.failed = 1;
+            break;
+        }
+
+        ld.firsts[created] = edges;
+        edges += sp->child_count;
+        if (edges > s->edge_count)
+        {
+            ld.failed = 1;
+            break;
+        }
+
+        ld.blocks[created] = createBlock(tr, sp->node_count, sp->key);
+        ld.blocks[created]->refs = 0;
+        storeBlock(tr, ld.blocks[created]);
+    }
+
+    if (!ld.failed && ld.count)
+    {
+        fillBlock(&ld, 0, root);
+        ld.blocks[0]->refs++;
+    }
+    // every block must be reached, and hold a position of its own, while
+    // blocks whose keys merely collide may both be kept
+    for (uint32_t i = 0; i < ld.count && !ld.failed; i++)
+    {
+        block *bl = ld.blocks[i];
+        ld.failed = !ld.filled[i] || findBlock(tr, bl->key, &bl->b, bl->sym) != bl;
+    }
+
+    if (ld.failed)
+    {
+        for (uint32_t i = 0; i < created; i++)
+        {
+            removeBlock(tr, ld.blocks[i]);
+            arenaFree(tr->arena, ld.blocks[i], blockSize(ld.blocks[i]->node_count));
+        }
+    }
+    else
+    {
+        tr->root.next = ld.count ? ld.blocks[0] : NULL;
+        tr->wins = s->wins;
+        tr->plays = s->plays;
+    }
+
+    free(ld.firsts);
+    free(ld.blocks);
+    free(ld.filled);
+    munmap(map, st.st_size);
+
+    return ld.failed ? -1 : 0;
+}
@@ -0,0 +1,61 @@
+# ifndef SNAPSHOT_H
+# define SNAPSHOT_H
+
+# include "tree.h"
+
+// first bytes of a snapshot file, "TRE2" in little endian
+# define SNAPSHOT_MAGIC 0x32455254
+
+// start of a snapshot file, followed by one span per block and then the
+// edges of every block in the same order
+// magic -> SNAPSHOT_MAGIC
+// span_count -> number of blocks
+// edge_count -> number of children over all blocks
+// turn -> the side to move at the root
+// pieces -> the pieces of the root position
+// wins -> discs won under the root
+// plays -> number of times the root was visited
+typedef struct
+{
+    uint32_t magic;
+    uint32_t span_count;
+    uint32_t edge_count;
+    uint32_t turn;
+    bitboard pieces[2];
+    uint64_t wins;
+    uint32_t plays;
+    uint32_t unused;
+} snapshot;
+
+// a block of children, the first span holds the root's children
+// key -> hash of the position the children were created from
+// node_count -> number of children there is room for
+// child_count -> number of children created, each with an edge
+// sym -> the symmetry giving the orientation of the children's moves
+typedef struct
+{
+    bitboard key;
+    uint16_t node_count;
+    uint16_t child_count;
+    uint32_t sym;
+} span;
+
+// a child in a block
+// wins -> discs won in the child's branch
+// plays -> number of times the child has been visited
+// next -> index of the span holding the child's children, or -1 for a leaf
+// move -> the square played to reach the child, or PASS
+typedef struct
+{
+    uint64_t wins;
+    uint32_t plays;
+    int32_t next;
+    uint8_t move;
+    uint8_t unused[7];
+} edge;
+
+int saveTree(tree *tr, const char *path);
+
+int loadTree(tree *tr, const char *path);
+
+# endif
@@ -0,0 +1,267 @@
+# include "solve.h"
+# include "clock.h"
+
+// the four quadrants of the board, used for parity ordering
+static const bitboard quadrants[4] =
+{
+    0x000000000F0F0F0FULL, 0x00000000F0F0F0F0ULL,
+    0x0F0F0F0F00000000ULL, 0xF0F0F0F000000000ULL,
+};
+
+// state of one solve
+// table -> hash table of score bounds
+// nodes -> number of positions searched so far
+// deadline -> wall clock time at which the search gives up
+// limit -> number of positions after which the search gives up, or 0
+// aborted -> set once the deadline or limit has passed
+typedef struct
+{
+    bound *table;
+    uint64_t nodes;
+    double deadline;
+    uint64_t limit;
+    int aborted;
+} solver;
+
+// gets the legal moves of the side to move
+// own -> the pieces of the side to move
+// opp -> the pieces of the other side
+// returns -> a bitboard of legal moves
+static bitboard movesOf(bitboard own, bitboard opp)
+{
+    board b = { .pieces = { own, opp }, .turn = black };
+    return getMoves(&b);
+}
+
+// gets the pieces flipped by a move of the side to move
+// own -> the pieces of the side to move
+// opp -> the pieces of the other side
+// sq -> the square of the move
+// returns -> a bitboard of the flipped pieces
+static bitboard flipsOf(bitboard own, bitboard opp, int sq)
+{
+    board b = { .pieces = { own, opp }, .turn = black };
+    return getFlips(&b, sq);
+}
+
+// scores a finished game, empty squares going to the winner
+// own -> the pieces of the side to move
+// opp -> the pieces of the other side
+// returns -> the final disc difference for the side to move
+static int finalScore(bitboard own, bitboard opp)
+{
+    int own_count = __builtin_popcountll(own);
+    int opp_count = __builtin_popcountll(opp);
+    int empties = 64 - own_count - opp_count;
+
+    if (own_count > opp_count)
+    {
+        return own_count - opp_count + empties;
+    }
+    if (own_count < opp_count)
+    {
+        return own_count - opp_count - empties;
+    }
+    return 0;
+}
+
+// finds the hash table entry of a position
+// sv -> the solve in progress
+// own -> the pieces of the side to move
+// opp -> the pieces of the other side
+// returns -> the entry the position maps to
+static bound *findBound(solver *sv, bitboard own, bitboard opp)
+{
+    bitboard h = own * 0x9E3779B97F4A7C15ULL ^ opp * 0xC2B2AE3D27D4EB4FULL;
+    return &sv->table[(h ^ (h >> 32)) & (SOLVE_TABLE - 1)];
+}
+
+// negamax alpha-beta search to the end of the game
+// sv -> the solve in progress
+// own -> the pieces of the side to move
+// opp -> the pieces of the other side
+// alpha -> lower bound of the scores of interest
+// beta -> upper bound of the scores of interest
+// passed -> whether the previous move was a pass
+// best_move -> if not NULL, filled with the square of the best move, or PASS
+// returns -> the score of the position, exact if it lies inside the window
+static int searchScore(solver *sv, bitboard own, bitboard opp, int alpha, int beta, int passed, uint8_t *best_move)
+{
+    if ((++sv->nodes & (SOLVE_CHECK - 1)) == 0 && (getClock() >= sv->deadline || (sv->limit && sv->nodes >= sv->limit)))
+    {
+        sv->aborted = 1;
+    }
+    if (sv->aborted)
+    {
+        return 0;
+    }
+
+    bitboard moves = movesOf(own, opp);
+
+    // pass, or end of the game when both sides have to pass
+    if (!moves)
+    {
+        if (best_move)
+        {
+            *best_move = PASS;
+        }
+        if (passed)
+        {
+            return finalScore(own, opp);
+        }
+        return -searchScore(sv, opp, own, -beta, -alpha, 1, NULL);
+    }
+
+    bitboard empty = ~(own | opp);
+    int empties = __builtin_popcountll(empty);
+
+    // near the end, try the moves in square order
+    if (empties < SOLVE_SHALLOW && !best_move)
+    {
+        int best = -65;
+        for (; moves; moves &= moves - 1)
+        {
+            int sq = __builtin_ctzll(moves);
+            bitboard flips = flipsOf(own, opp, sq);
+
+            int score = -searchScore(sv, opp ^ flips, own | flips | (1ULL << sq), -beta, -alpha, 0, NULL);
+            if (score > best)
+            {
+                best = score;
+                if (score > alpha)
+                {
+                    alpha = score;
+                    if (alpha >= beta)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    // narrow the window with known bounds
+    bound *entry = findBound(sv, own, opp);
+    uint8_t hash_move = PASS;
+    if (entry->own == own && entry->opp == opp)
+    {
+        if (!best_move)
+        {
+            if (entry->lower >= beta || entry->lower == entry->upper)
+            {
+                return entry->lower;
+            }
+            if (entry->upper <= alpha)
+            {
+                return entry->upper;
+            }
+            alpha = alpha > entry->lower ? alpha : entry->lower;
+            beta = beta < entry->upper ? beta : entry->upper;
+        }
+        hash_move = entry->move;
+    }
+
+    // order the moves: the hash move first, then fastest first (fewest
+    // opponent replies), preferring quadrants with an odd number of empties
+    int count = 0;
+    int squares[64];
+    int keys[64];
+    bitboard flipsets[64];
+    for (; moves; moves &= moves - 1)
+    {
+        int sq = __builtin_ctzll(moves);
+        bitboard flips = flipsOf(own, opp, sq);
+        bitboard placed = 1ULL << sq;
+
+        int key = 16 * __builtin_popcountll(movesOf(opp ^ flips, own | flips | placed));
+        for (int q = 0; q < 4; q++)
+        {
+            if ((quadrants[q] & placed) && (__builtin_popcountll(quadrants[q] & empty) & 1))
+            {
+                key -= 8;
+            }
+        }
+        if (sq == hash_move)
+        {
+            key = -1000;
+        }
+
+        // insertion sort
+        int i = count++;
+        while (i > 0 && keys[i - 1] > key)
+        {
+            squares[i] = squares[i - 1];
+            keys[i] = keys[i - 1];
+            flipsets[i] = flipsets[i - 1];
+            i--;
+        }
+        squares[i] = sq;
+        keys[i] = key;
+        flipsets[i] = flips;
+    }
+
+    int alpha_start = alpha;
+    int best = -65;
+    int best_sq = squares[0];
+    for (int i = 0; i < count; i++)
+    {
+        bitboard flips = flipsets[i];
+
+        int score = -searchScore(sv, opp ^ flips, own | flips | (1ULL << squares[i]), -beta, -alpha, 0, NULL);
+        if (score > best)
+        {
+            best = score;
+            best_sq = squares[i];
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (sv->aborted)
+    {
+        return 0;
+    }
+
+    // remember the bounds this search proved
+    entry->own = own;
+    entry->opp = opp;
+    entry->lower = best > alpha_start ? best : -64;
+    entry->upper = best < beta ? best : 64;
+    entry->move = best_sq;
+
+    if (best_move)
+    {
+        *best_move = best_sq;
+    }
+    return best;
+}
+
+// solves a position exactly, or gives up at a deadline or a node limit, the
+// limit giving up at the same point on every run
+// b -> the position to solve
+// deadline -> wall clock time at which to give up
+// limit -> number of positions searched after which to give up, or 0
+// sol -> filled with the best move, its score and the search statistics
+void solveBoard(board *b, double deadline, uint64_t limit, solution *sol)
+{
+    double start = getClock();
+    solver sv = { (bound *) calloc(SOLVE_TABLE, sizeof(bound)), 0, deadline, limit, 0 };
+
+    uint8_t move = PASS;
+    int score = searchScore(&sv, b->pieces[b->turn], b->pieces[b->turn^1], -64, 64, 0, &move);
+
+    free(sv.table);
+
+    sol->move = moveBit(move);
+    sol->score = score;
+    sol->solved = !sv.aborted;
+    sol->nodes = sv.nodes;
+    sol->seconds = getClock() - start;
+}
@@ -0,0 +1,48 @@
+# ifndef SOLVE_H
+# define SOLVE_H
+
+# include "board.h"
+
+// number of entries in the solver's hash table, a power of two
+# define SOLVE_TABLE (1 << 18)
+
+// positions with fewer empty squares are searched without move ordering or
+// the hash table, which cost more than they save so close to the end
+# define SOLVE_SHALLOW 6
+
+// nodes searched between looks at the clock
+# define SOLVE_CHECK 4096
+
+// solver hash table entry, for a position with a given side to move
+// own -> the pieces of the side to move
+// opp -> the pieces of the other side
+// lower -> proven lower bound of the score
+// upper -> proven upper bound of the score
+// move -> the best move found, or PASS
+typedef struct
+{
+    bitboard own;
+    bitboard opp;
+    int8_t lower;
+    int8_t upper;
+    uint8_t move;
+} bound;
+
+// result of solving a position
+// move -> a move reaching the best final score, 0 for a pass
+// score -> final disc difference for the side to move with perfect play
+// solved -> whether the search finished before its deadline
+// nodes -> number of positions searched
+// seconds -> time taken by the search
+typedef struct
+{
+    bitboard move;
+    int score;
+    int solved;
+    uint64_t nodes;
+    double seconds;
+} solution;
+
+void solveBoard(board *b, double deadline, uint64_t limit, solution *sol);
+
+# endif
@@ -0,0 +1,142 @@
+# include <string.h>
+# include <pthread.h>
+# include "stats.h"
+
+# ifdef STATS
+
+// the counters of the calling thread, not yet added to the move's total
+__thread stats thread_stats;
+
+// the counters of every thread since the last reset
+static stats move_stats;
+
+// guards move_stats against threads flushing at the same time
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *phase_names[phase_count] = { "select", "expand", "simulate", "backpropagate" };
+
+// clears the counters of the move, called before each search
+void resetStats()
+{
+    pthread_mutex_lock(&stats_lock);
+    memset(&move_stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&stats_lock);
+
+    memset(&thread_stats, 0, sizeof(stats));
+}
+
+// adds the calling thread's counters to the move's total and clears them,
+// called by each search thread as it finishes
+void flushStats()
+{
+    uint64_t *from = (uint64_t *) &thread_stats;
+    uint64_t *to = (uint64_t *) &move_stats;
+
+    pthread_mutex_lock(&stats_lock);
+    for (size_t i = 0; i < sizeof(stats) / sizeof(uint64_t); i++)
+    {
+        to[i] += from[i];
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    memset(&thread_stats, 0, sizeof(stats));
+}
+
+// copies the counters of the move
+// s -> filled with the counters
+void collectStats(stats *s)
+{
+    pthread_mutex_lock(&stats_lock);
+    *s = move_stats;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+// prints the counters of the move as comment lines
+void printStats()
+{
+    stats s;
+    collectStats(&s);
+
+    uint64_t total = 0;
+    for (int i = 0; i < phase_count; i++)
+    {
+        total += s.cycles[i];
+    }
+
+    for (int i = 0; i < phase_count; i++)
+    {
+        printf("C  Phase %s: %4.1f%%, %'llu calls, %'llu cycles/call\n", phase_names[i],
+            total ? 100.0 * s.cycles[i] / total : 0, (unsigned long long) s.calls[i],
+            s.calls[i] ? (unsigned long long) (s.cycles[i] / s.calls[i]) : 0);
+    }
+
+    // histogram of selection depths, skipping lengths no round reached
+    printf("C  Select Depth:");
+    for (int i = 0; i <= STATS_DEPTH; i++)
+    {
+        if (s.depths[i])
+        {
+            printf(" %i:%llu", i, (unsigned long long) s.depths[i]);
+        }
+    }
+    printf("\n");
+
+    printf("C  Allocs: %'llu from the arena (%'llu KiB), %'llu from the system\n",
+        (unsigned long long) s.allocs, (unsigned long long) (s.alloc_bytes / 1024), (unsigned long long) s.mallocs);
+}
+
+// writes the counters of the move as a single line of json
+// file -> the file to write to
+// empties -> the number of empty squares of the searched position
+void dumpStats(FILE *file, int empties)
+{
+    stats s;
+    collectStats(&s);
+
+    fprintf(file, "{\"empties\":%i,\"phases\":{", empties);
+    for (int i = 0; i < phase_count; i++)
+    {
+        fprintf(file, "%s\"%s\":{\"cycles\":%llu,\"calls\":%llu}", i ? "," : "", phase_names[i],
+            (unsigned long long) s.cycles[i], (unsigned long long) s.calls[i]);
+    }
+
+    fprintf(file, "},\"depths\":[");
+    int last = STATS_DEPTH;
+    while (last > 0 && !s.depths[last])
+    {
+        last--;
+    }
+    for (int i = 0; i <= last; i++)
+    {
+        fprintf(file, "%s%llu", i ? "," : "", (unsigned long long) s.depths[i]);
+    }
+
+    fprintf(file, "],\"allocs\":%llu,\"alloc_bytes\":%llu,\"mallocs\":%llu}\n",
+        (unsigned long long) s.allocs, (unsigned long long) s.alloc_bytes, (unsigned long long) s.mallocs);
+    fflush(file);
+}
+
+# else
+
+void resetStats()
+{
+}
+
+void flushStats()
+{
+}
+
+void collectStats(stats *s)
+{
+    memset(s, 0, sizeof(stats));
+}
+
+void printStats()
+{
+}
+
+void dumpStats(FILE *file, int empties)
+{
+}
+
+# endif
@@ -0,0 +1,79 @@
+# ifndef STATS_H
+# define STATS_H
+
+# include <stdio.h>
+# include <stdint.h>
+
+// deepest selection path recorded, longer paths share the last bucket
+# define STATS_DEPTH 128
+
+// the phases of a search round
+typedef enum
+{
+    select_phase, expand_phase, simulate_phase, backpropagate_phase, phase_count
+} phase;
+
+// search counters, gathered per thread and combined once per move
+// cycles -> time stamp counter cycles spent in each phase
+// calls -> number of times each phase ran
+// depths -> number of rounds whose selection path had each length
+// allocs -> number of allocations from the arenas
+// alloc_bytes -> bytes handed out by those allocations
+// mallocs -> number of allocations the arenas requested from the system
+typedef struct
+{
+    uint64_t cycles[phase_count];
+    uint64_t calls[phase_count];
+    uint64_t depths[STATS_DEPTH + 1];
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+    uint64_t mallocs;
+} stats;
+
+// the counters are only compiled in with -DSTATS (make STATS=1), without it
+// the macros below vanish and the functions do nothing
+# ifdef STATS
+
+# include <x86intrin.h>
+
+extern __thread stats thread_stats;
+
+// runs a statement, adding its cycles and a call to a phase
+# define timePhase(ph, stmt) do \
+{ \
+    uint64_t start_ = __rdtsc(); \
+    stmt; \
+    thread_stats.cycles[ph] += __rdtsc() - start_; \
+    thread_stats.calls[ph]++; \
+} while (0)
+
+// records the length of a selection path
+# define countDepth(length) \
+    (thread_stats.depths[(length) < STATS_DEPTH ? (length) : STATS_DEPTH]++)
+
+// records an arena allocation
+# define countAlloc(bytes) (thread_stats.allocs++, thread_stats.alloc_bytes += (bytes))
+
+// records memory requested from the system by an arena
+# define countMalloc() (thread_stats.mallocs++)
+
+# else
+
+# define timePhase(ph, stmt) do { stmt; } while (0)
+# define countDepth(length) ((void) 0)
+# define countAlloc(bytes) ((void) 0)
+# define countMalloc() ((void) 0)
+
+# endif
+
+void resetStats();
+
+void flushStats();
+
+void collectStats(stats *s);
+
+void printStats();
+
+void dumpStats(FILE *file, int empties);
+
+# endif
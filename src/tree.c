@@ -1,25 +1,226 @@
+# include <immintrin.h>
 # include "tree.h"
 
-// creates a tree node
-// parent -> the node connected above the new node
-// b -> game state of the node
-// move -> the move that, when played on the parent board, creates the node board
-// returns -> the new node
-node *createNode(node *parent, board *b, bitboard move)
+// number of slots a new transposition table starts with
+# define TABLE_START 4096
+
+// weight of the exploration term of UCT
+# define EXPLORATION 1.414f
+
+// turns a disc count into wins, a won game holding all 64 discs
+# define WIN_SCALE (1.0f / 64)
+
+// number of bytes used by a block with the given number of children
+// node_count -> the number of children
+// returns -> the size of the block allocation
+size_t blockSize(int node_count)
+{
+    return sizeof(block) + node_count * (sizeof(uint64_t) + sizeof(node) + sizeof(uint32_t));
+}
+
+// creates an empty block of child nodes
+// tr -> the tree whose arena holds the block
+// node_count -> the number of children
+// key -> hash of the position the children are created from
+// returns -> the new block, with the statistics zeroed and no children
+block *createBlock(tree *tr, int node_count, bitboard key)
 {
-    node *nn = malloc(sizeof(node));
+    pthread_mutex_lock(&tr->lock);
+    block *bl = arenaAlloc(tr->arena, blockSize(node_count));
+    pthread_mutex_unlock(&tr->lock);
+
+    // the play counts come last, so the wins and nodes stay 8 byte aligned
+    bl->wins = (uint64_t *) (bl + 1);
+    bl->nodes = (node *) (bl->wins + node_count);
+    bl->plays = (uint32_t *) (bl->nodes + node_count);
+    bl->node_count = node_count;
+    bl->sim_count = 0;
+    bl->child_count = 0;
+    bl->key = key;
+    bl->untried = 0;
+    bl->sym = 0;
+    bl->refs = 1;
+    bl->mark = 0;
+
+    memset(bl->wins, 0, node_count * sizeof(uint64_t));
+    memset(bl->plays, 0, node_count * sizeof(uint32_t));
+
+    return bl;
+}
 
-    nn->parent = parent;
+// whether a position is early enough to be keyed by its canonical hash
+// b -> the position
+// returns -> 1 if it has at most SYMMETRY_DISCS discs
+static int earlyPosition(board *b)
+{
+    return __builtin_popcountll(b->pieces[0] | b->pieces[1]) <= SYMMETRY_DISCS;
+}
+
+// hashes a position for the transposition table, early positions by their
+// canonical hash so that their symmetric copies share one block
+// b -> the position
+// sym -> filled with the symmetry taking the position to the orientation
+//        its key was taken in, 0 for later positions
+// returns -> the key of the position
+bitboard positionKey(board *b, int *sym)
+{
+    if (earlyPosition(b))
+    {
+        return canonicalHash(b, sym);
+    }
+
+    *sym = 0;
+    return b->hash;
+}
+
+// the moves a position's children are created for, symmetric moves of early
+// positions sharing one child
+// b -> the position
+// returns -> the moves
+bitboard childMoves(board *b)
+{
+    return earlyPosition(b) ? distinctMoves(b) : b->moves;
+}
+
+// sets up an empty block to create the children of a position
+// bl -> the block, with room for every child
+// b -> the position, in the orientation the children's moves will have
+void addChildren(block *bl, board *b)
+{
+    bl->b = *b;
+
+    // a pass is held by a placeholder bit, as the position has no moves
+    bitboard moves = childMoves(b);
+    bl->untried = moves ? moves : 1;
+}
+
+// creates the child of a move taken out of a block's untried moves, its
+// statistics staying zero
+// bl -> the block
+// move -> the move, or the placeholder bit of a pass
+// returns -> index of the new child
+static int createChild(block *bl, bitboard move)
+{
+    int index = __atomic_fetch_add(&bl->child_count, 1, __ATOMIC_RELAXED);
+    if (!bl->b.moves)
+    {
+        move = 0;
+    }
+
+    node *nn = &bl->nodes[index];
     nn->next = NULL;
-    nn->node_count = 0;
-    nn->sim_count = 0;
-    nn->wins = 0;
-    nn->plays = 0;
+    nn->b = bl->b;
+    nn->move = bitMove(move);
+    makeMove(&nn->b, move);
+
+    return index;
+}
+
+// checks whether a block holds the children of a position, comparing the
+// boards in the orientation their keys were taken in
+// bl -> the block
+// b -> the position
+// sym -> the symmetry positionKey gave the position
+// returns -> 1 if the block is the position's
+static int samePosition(block *bl, board *b, int sym)
+{
+    return b->turn == bl->b.turn
+        && transformBits(b->pieces[0], sym) == transformBits(bl->b.pieces[0], bl->sym)
+        && transformBits(b->pieces[1], sym) == transformBits(bl->b.pieces[1], bl->sym);
+}
+
+// finds the block of a position in the transposition table
+// positions whose keys collide each keep their own entry, so a block is only
+// returned once its board matches
+// callers hold the tree lock
+// tr -> the tree to search
+// key -> hash of the position
+// b -> the position
+// sym -> the symmetry positionKey gave the position
+// returns -> the block, or NULL if the position has no children yet
+block *findBlock(tree *tr, bitboard key, board *b, int sym)
+{
+    size_t mask = tr->table_size - 1;
+
+    for (size_t i = key & mask; tr->table[i].bl; i = (i + 1) & mask)
+    {
+        if (tr->table[i].key == key && samePosition(tr->table[i].bl, b, sym))
+        {
+            return tr->table[i].bl;
+        }
+    }
+
+    return NULL;
+}
+
+// adds a block to the transposition table, growing it past half full
+// callers hold the tree lock
+// tr -> the tree to add to
+// bl -> the block to add, keyed by its position
+void storeBlock(tree *tr, block *bl)
+{
+    if (2 * (tr->table_count + 1) > tr->table_size)
+    {
+        entry *old = tr->table;
+        size_t old_size = tr->table_size;
+
+        tr->table_size *= 2;
+        tr->table_count = 0;
+        tr->table = (entry *) calloc(tr->table_size, sizeof(entry));
+
+        for (size_t i = 0; i < old_size; i++)
+        {
+            if (old[i].bl)
+            {
+                storeBlock(tr, old[i].bl);
+            }
+        }
+
+        free(old);
+    }
+
+    size_t mask = tr->table_size - 1;
+    size_t i = bl->key & mask;
+    while (tr->table[i].bl)
+    {
+        i = (i + 1) & mask;
+    }
+
+    tr->table[i].key = bl->key;
+    tr->table[i].bl = bl;
+    tr->table_count++;
+}
 
-    nn->b = b;
-    nn->move = move;
+// removes a block from the transposition table, shifting later entries of
+// the same probe run back so that no lookup stops early
+// callers hold the tree lock
+// tr -> the tree to remove from
+// bl -> the block to remove
+void removeBlock(tree *tr, block *bl)
+{
+    size_t mask = tr->table_size - 1;
+    size_t i = bl->key & mask;
+    while (tr->table[i].bl != bl)
+    {
+        i = (i + 1) & mask;
+    }
+
+    // backward shift deletion
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; tr->table[j].bl; j = (j + 1) & mask)
+    {
+        size_t home = tr->table[j].key & mask;
 
-    return nn;
+        // move the entry into the hole unless its home lies after the hole
+        if (((j - home) & mask) >= ((j - hole) & mask))
+        {
+            tr->table[hole] = tr->table[j];
+            hole = j;
+        }
+    }
+
+    tr->table[hole].bl = NULL;
+    tr->table_count--;
 }
 
 // creates a tree 
@@ -29,70 +230,327 @@ tree *createTree(board *b)
 {
     // mallocate
     tree *tr = (tree *) malloc(sizeof(tree));
-    tr->root = createNode(NULL, cloneBoard(b), 0x0);
+    tr->arena = createArena();
+
+    tr->root.next = NULL;
+    tr->root.b = *b;
+    tr->root.move = PASS;
+    tr->wins = 0;
+    tr->plays = 0;
+    positionKey(&tr->root.b, &tr->sym);
+    pthread_mutex_init(&tr->lock, NULL);
+
+    tr->table_size = TABLE_START;
+    tr->table_count = 0;
+    tr->table = (entry *) calloc(tr->table_size, sizeof(entry));
+    tr->hits = 0;
+    tr->stores = 0;
+    tr->saved = 0;
+    tr->nodes = 0;
+    tr->limit = 0;
+    pthread_rwlock_init(&tr->rounds, NULL);
+    tr->pruning = 0;
+    tr->pruned = 0;
+    tr->prunes = 0;
+    tr->epoch = 0;
 
     return tr;
 }
 
 // wrapper to delete the entire tree struct
+// every block lives in the arena, so the whole tree is released at once
 // tr -> the tree to delete
 void deleteTree(tree *tr)
 {
-    deleteNodes(tr->root);
+    pthread_mutex_destroy(&tr->lock);
+    pthread_rwlock_destroy(&tr->rounds);
+    deleteArena(tr->arena);
+    free(tr->table);
     free(tr);
 }
 
-// deletes a subtree
+// releases the subtree below a node, returning every block that no other
+// node shares to the arena
+// tr -> the tree that owns the subtree
 // node -> the root of the subtree to delete
-void deleteNodes(node *node)
+void deleteNodes(tree *tr, node *node)
 {
+    block *bl = node->next;
+    node->next = NULL;
+
+    if (!bl || --bl->refs > 0)
+    {
+        return;
+    }
+
+    removeBlock(tr, bl);
+
     // delete node children
-    if (node->next)
+    for (int i=0; i < bl->child_count; i++)
     {
-        for (int i=0; i < node->node_count; i++)
+        deleteNodes(tr, &bl->nodes[i]);
+    }
+
+    arenaFree(tr->arena, bl, blockSize(bl->node_count));
+}
+
+// releases the subtree below a block while other threads may be searching
+// the tree, taking the tree lock for each block so that a block is never
+// found in the table once its last reference is gone
+// tr -> the tree that owns the subtree
+// bl -> the block to release, one of its references belonging to the caller
+void releaseNodes(tree *tr, block *bl)
+{
+    pthread_mutex_lock(&tr->lock);
+    int last = --bl->refs == 0;
+    if (last)
+    {
+        removeBlock(tr, bl);
+    }
+    pthread_mutex_unlock(&tr->lock);
+
+    if (!last)
+    {
+        return;
+    }
+
+    // no other node reaches the block, so its children no longer change
+    for (int i = 0; i < bl->child_count; i++)
+    {
+        if (bl->nodes[i].next)
         {
-            deleteNodes(node->next[i]);
+            releaseNodes(tr, bl->nodes[i].next);
         }
     }
 
-    // frees the current node
-    free(node->next);
-    deleteBoard(node->b);
-    free(node);
+    pthread_mutex_lock(&tr->lock);
+    arenaFree(tr->arena, bl, blockSize(bl->node_count));
+    pthread_mutex_unlock(&tr->lock);
+}
+
+// gives a child of the root as a move on the root board, the root's block
+// possibly having been created from a symmetric copy of the root
+// tr -> the tree
+// bl -> the root's block
+// i -> index of the child
+// returns -> the square of the move, or PASS
+square rootMove(tree *tr, block *bl, int i)
+{
+    square move = bl->nodes[i].move;
+    if (move == PASS || bl->sym == tr->sym)
+    {
+        return move;
+    }
+
+    // through the canonical orientation, which both share
+    return bitMove(restoreBits(transformBits(moveBit(move), bl->sym), tr->sym));
 }
 
 // remove all but one root subtree
+// the discarded blocks are handed back rather than freed, so that the
+// caller can release them off the critical path with releaseNodes
 // tr -> the tree to perform the operation on
 // move -> the move that determines which subtree to keep
-void updateTree(tree *tr, bitboard move)
+// returns -> the old root's children, or NULL if the root was never expanded
+block *updateTree(tree *tr, bitboard move)
 {
-    // find new node
-    node *nn = NULL;
+    block *bl = tr->root.next;
+    board b = tr->root.b;
+    makeMove(&b, move);
+
+    // find the child of the move before the root changes orientation, or
+    // the child standing for it if the move was merged with a symmetric one
+    int kept = -1;
+    for (int i = 0; bl && i < bl->child_count && kept < 0; i++)
+    {
+        if (moveBit(rootMove(tr, bl, i)) == move)
+        {
+            kept = i;
+        }
+    }
+    if (bl && kept < 0)
+    {
+        bitboard key = canonicalHash(&b, NULL);
+        for (int i = 0; i < bl->child_count && kept < 0; i++)
+        {
+            if (canonicalHash(&bl->nodes[i].b, NULL) == key)
+            {
+                kept = i;
+            }
+        }
+    }
 
-    node *curr = NULL;
-    for (int i = 0; i < tr->root->node_count; i++)
+    // the root always holds the actual position, whatever orientation the
+    // kept children were created in
+    tr->root.b = b;
+    tr->root.move = bitMove(move);
+    tr->root.next = NULL;
+    tr->wins = 0;
+    tr->plays = 0;
+    positionKey(&b, &tr->sym);
+
+    // later positions are keyed by their exact board, so children kept from
+    // a symmetric copy are in the orientation of that copy
+    node *curr = kept >= 0 ? &bl->nodes[kept] : NULL;
+    if (curr && curr->next && !earlyPosition(&b))
     {
-        curr = tr->root->next[i];
-        if (curr->move == move)
+        while (transformBits(b.pieces[0], tr->sym) != curr->b.pieces[0] || transformBits(b.pieces[1], tr->sym) != curr->b.pieces[1])
         {
-            // keep subtree
-            nn = curr;
-        } 
-        else 
+            tr->sym++;
+        }
+    }
+
+    // the root was never expanded, so start over from the new position
+    if (!bl)
+    {
+        return NULL;
+    }
+
+    if (curr)
+    {
+        // keep subtree, nodes hold no parent pointers so it can be
+        // copied, and the copy holds its own reference to the children
+        tr->root.next = curr->next;
+        tr->wins = bl->wins[kept];
+        tr->plays = bl->plays[kept];
+
+        // an earlier subtree may still be being released
+        if (curr->next)
         {
-            // delete subtree
-            deleteNodes(curr);
+            pthread_mutex_lock(&tr->lock);
+            curr->next->refs++;
+            pthread_mutex_unlock(&tr->lock);
         }
     }
 
-    // free root
-    free(tr->root->next);
-    deleteBoard(tr->root->b);
-    free(tr->root);
+    return bl;
+}
+
+// counts the memory a tree uses, for callers holding the tree lock
+// tr -> the tree to measure
+// returns -> bytes of blocks and transposition table
+static size_t usedBytes(tree *tr)
+{
+    return tr->arena->in_use + tr->table_size * sizeof(entry);
+}
+
+// counts the memory a tree uses
+// tr -> the tree to measure
+// returns -> bytes of blocks and transposition table
+size_t treeMemory(tree *tr)
+{
+    pthread_mutex_lock(&tr->lock);
+    size_t bytes = usedBytes(tr);
+    pthread_mutex_unlock(&tr->lock);
 
-    // set new node as root
-    nn->parent = NULL;
-    tr->root = nn;
+    return bytes;
+}
+
+// adds up the bytes of the blocks below a node by the node's play count,
+// visiting each block once
+// tr -> the tree being pruned
+// node -> the node whose children are measured
+// plays -> the play count of the node
+// bytes -> bytes of blocks per bucket of play counts, a bucket per bit
+static void measureNodes(tree *tr, node *node, uint32_t plays, size_t *bytes)
+{
+    block *bl = node->next;
+    if (!bl || bl->mark == tr->epoch)
+    {
+        return;
+    }
+    bl->mark = tr->epoch;
+
+    bytes[plays ? 32 - __builtin_clz(plays) : 0] += blockSize(bl->node_count);
+
+    for (int i = 0; i < bl->child_count; i++)
+    {
+        measureNodes(tr, &bl->nodes[i], bl->plays[i], bytes);
+    }
+}
+
+// turns every node visited fewer than a number of times back into a leaf,
+// its statistics staying in its parent's block
+// tr -> the tree being pruned
+// node -> the node to collapse or descend from
+// plays -> the play count of the node
+// threshold -> play count below which nodes are collapsed
+static void collapseNodes(tree *tr, node *node, uint32_t plays, uint32_t threshold)
+{
+    block *bl = node->next;
+    if (!bl)
+    {
+        return;
+    }
+
+    if (plays < threshold)
+    {
+        deleteNodes(tr, node);
+        return;
+    }
+
+    if (bl->mark == tr->epoch)
+    {
+        return;
+    }
+    bl->mark = tr->epoch;
+
+    for (int i = 0; i < bl->child_count; i++)
+    {
+        collapseNodes(tr, &bl->nodes[i], bl->plays[i], threshold);
+    }
+}
+
+// frees the least visited subtrees until the tree is back under
+// PRUNE_TARGET of its limit, the root's children always staying
+// the caller holds the rounds lock for writing
+// tr -> the tree to prune
+void pruneTree(tree *tr)
+{
+    // threads between rounds may still be measuring the tree
+    pthread_mutex_lock(&tr->lock);
+
+    size_t used = usedBytes(tr);
+    size_t target = (size_t) (tr->limit * PRUNE_TARGET);
+    block *root = tr->root.next;
+    if (!root || used <= target)
+    {
+        pthread_mutex_unlock(&tr->lock);
+        return;
+    }
+
+    // find the smallest power of two of plays below which enough is freed
+    size_t bytes[33] = { 0 };
+    tr->epoch++;
+    root->mark = tr->epoch;
+    for (int i = 0; i < root->child_count; i++)
+    {
+        measureNodes(tr, &root->nodes[i], root->plays[i], bytes);
+    }
+
+    int bucket = 0;
+    size_t freed = bytes[0];
+    while (bucket < 32 && freed < used - target)
+    {
+        freed += bytes[++bucket];
+    }
+    uint32_t threshold = bucket < 32 ? 1U << bucket : UINT32_MAX;
+
+    // pruning is not a re-rooting, so it is left out of the reclaimed bytes
+    size_t reclaimed = tr->arena->reclaimed;
+
+    tr->epoch++;
+    root->mark = tr->epoch;
+    for (int i = 0; i < root->child_count; i++)
+    {
+        collapseNodes(tr, &root->nodes[i], root->plays[i], threshold);
+    }
+
+    tr->pruned += used - usedBytes(tr);
+    tr->prunes++;
+    tr->arena->reclaimed = reclaimed;
+
+    pthread_mutex_unlock(&tr->lock);
 }
 
 // wrapper for printing the tree
@@ -100,37 +558,41 @@ void updateTree(tree *tr, bitboard move)
 void printTree(tree *tr)
 {
     char buf[128] = ""; 
-    printNodes(tr->root, buf, 1, 2);
+    printNodes(&tr->root, tr->wins, tr->plays, buf, 1, 2);
     printf("C   \n");
 }
 
 // prints a subtree recursively
 // node -> the root node of the subtree
+// wins -> the discs won under the node
+// plays -> the number of plays of the node
 // indent -> the level of indent to print the node (recursively set)
 // last -> whether or not the node is a leaf
 // depth -> how many nodes deep the function should print
 // 
 // https://stackoverflow.com/questions/1649027
-void printNodes(node *node, char *indent, int last, int depth)
+void printNodes(node *node, uint64_t wins, uint32_t plays, char *indent, int last, int depth)
 {
     if (depth == 0)
     {
         return;
     }
 
+    // a won game is worth all 64 discs
+    double won = wins / 64.0;
+
     // print node
-    if (node->move)
+    if (node->move != PASS)
     {
         // convert move to string
-        int move = log(node->move) / log(2);
-        char file = 97 + move % 8;
-        int rank = move / 8 + 1;
+        char file = 97 + node->move % 8;
+        int rank = node->move / 8 + 1;
         
-        printf("C  %s+- %c%i %f/%f|%i\n", indent, file, rank, node->wins, node->plays-node->wins, node->plays);
+        printf("C  %s+- %c%i %f/%f|%u\n", indent, file, rank, won, plays-won, plays);
     }
     else
     {
-        printf("C  %s+- %f/%f|%i\n", indent, node->wins, node->plays-node->wins, node->plays);
+        printf("C  %s+- %f/%f|%u\n", indent, won, plays-won, plays);
     }
 
     // determine next indentation level
@@ -139,9 +601,10 @@ void printNodes(node *node, char *indent, int last, int depth)
     strcat(next_indent, last ? "   " : "|  ");
 
     // print child nodes
-    for (int i=0; i < node->node_count; i++)
+    block *bl = node->next;
+    for (int i=0; bl && i < bl->child_count; i++)
     {
-        printNodes(node->next[i], next_indent, i == node->node_count - 1, depth - 1);
+        printNodes(&bl->nodes[i], bl->wins[i], bl->plays[i], next_indent, i == bl->child_count - 1, depth - 1);
     }
 }
 
@@ -150,20 +613,21 @@ void printNodes(node *node, char *indent, int last, int depth)
 // returns -> the depth
 int getDepth(node *curr)
 {
-    if (curr->node_count == 0)
+    block *bl = curr->next;
+    if (!bl)
     {
         return 0;
     }
 
     // get move with highest number of plays
     node *best_node = NULL;
-    int best_score;
-    for (int i = 0; i < curr->node_count; i++)
+    uint32_t best_score = 0;
+    for (int i = 0; i < bl->child_count; i++)
     {
-        int score = curr->next[i]->plays;
+        uint32_t score = bl->plays[i];
         if (!best_node || score > best_score)
         {
-            best_node = curr->next[i];
+            best_node = &bl->nodes[i];
             best_score = score;
         }
     }
@@ -172,169 +636,311 @@ int getDepth(node *curr)
 }
 
 // does one round of monte carlo tree search
+// several threads may run rounds on the same tree at once
 // tr -> the tree to perform the round on
+// r -> random number generator of the calling thread
 // 
 // https://en.wikipedia.org/wiki/Monte_Carlo_tree_search#Principle_of_operation
-void doRound(tree *tr)
+void doRound(tree *tr, rng *r)
+{
+    path p;
+    node *leaf;
+    node *nn;
+    int res;
+
+    timePhase(select_phase, leaf = selectLeaf(tr, &p));
+    timePhase(expand_phase, nn = expandTree(tr, leaf, &p, r));
+    timePhase(simulate_phase, res = simulateTree(nn, r));
+    timePhase(backpropagate_phase, backpropagateTree(&p, res));
+    countDepth(p.length);
+}
+
+// adds a node to the path, applying a virtual loss: the play is counted now
+// and the win only once the playout returns, so threads descending at the
+// same time are steered away from each other
+// p -> the path to extend
+// wins -> the discs won under the node
+// plays -> the play count of the node
+static void pushPath(path *p, uint64_t *wins, uint32_t *plays)
 {
-    node *leaf = selectLeaf(tr);
-    node *nn = expandTree(leaf);
-    double res = simulateTree(nn);
-    backpropagateTree(nn, res);
+    __atomic_fetch_add(plays, 1, __ATOMIC_RELAXED);
+
+    p->wins[p->length] = wins;
+    p->plays[p->length] = plays;
+    p->length++;
 }
 
+// picks the child with the best UCT score, the first one on ties
+// bl -> the block to choose from, every child visited at least once
+// parent_log -> log of the parent's play count
+// returns -> index of the child
+static int selectChildScalar(block *bl, float parent_log)
+{
+    int best_index = 0;
+    float best_score = -INFINITY;
+
+    for (int i = 0; i < bl->node_count; i++)
+    {
+        // the disc count is exact, only the win rate is rounded
+        float wins = (float) __atomic_load_n(&bl->wins[i], __ATOMIC_RELAXED) * WIN_SCALE;
+        float inverse = 1.0f / (float) __atomic_load_n(&bl->plays[i], __ATOMIC_RELAXED);
+
+        // UCT with draw calculation included
+        float score = wins * inverse + EXPLORATION * sqrtf(parent_log * inverse);
+
+        // written as selects so the loop does not branch on the scores
+        int better = score > best_score;
+        best_index = better ? i : best_index;
+        best_score = better ? score : best_score;
+    }
+
+    return best_index;
+}
+
+// converts four disc counts to doubles without rounding, setting them as
+// the mantissa of 2^52 and taking 2^52 away, as avx2 has no such conversion
+// counts -> the disc counts, each below 2^52
+// returns -> the counts as doubles
+__attribute__((target("avx2")))
+static __m256d exactDoubles(__m256i counts)
+{
+    const __m256d offset = _mm256_set1_pd(0x1p52);
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(counts, _mm256_castpd_si256(offset))), offset);
+}
+
+// picks the child with the best UCT score, the first one on ties, scoring
+// eight children at a time
+// built without fma, so that no multiply and add are fused and the scores
+// round exactly as in selectChildScalar
+// bl -> the block to choose from, every child visited at least once
+// parent_log -> log of the parent's play count
+// returns -> index of the child
+__attribute__((target("avx2")))
+static int selectChildAVX2(block *bl, float parent_log)
+{
+    const __m256 log_term = _mm256_set1_ps(parent_log);
+    const __m256 weight = _mm256_set1_ps(EXPLORATION);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    __m256 best_scores = _mm256_set1_ps(-INFINITY);
+    __m256i best_indices = _mm256_setzero_si256();
+
+    for (int i = 0; i < bl->node_count; i += 8)
+    {
+        // the lanes past the last child load nothing and score -inf
+        __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(i), lanes);
+        __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(bl->node_count), indices);
+
+        // the disc counts are converted through doubles, which hold them
+        // exactly, and then rounded to floats as in selectChildScalar
+        __m256i low = _mm256_maskload_epi64((const long long *) &bl->wins[i], _mm256_cvtepi32_epi64(_mm256_castsi256_si128(valid)));
+        __m256i high = _mm256_maskload_epi64((const long long *) &bl->wins[i + 4], _mm256_cvtepi32_epi64(_mm256_extracti128_si256(valid, 1)));
+        __m256 wins = _mm256_set_m128(_mm256_cvtpd_ps(exactDoubles(high)), _mm256_cvtpd_ps(exactDoubles(low)));
+        wins = _mm256_mul_ps(wins, _mm256_set1_ps(WIN_SCALE));
+        __m256i plays = _mm256_maskload_epi32((const int *) &bl->plays[i], valid);
+
+        __m256 inverse = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_cvtepi32_ps(plays));
+        __m256 explore = _mm256_sqrt_ps(_mm256_mul_ps(log_term, inverse));
+        __m256 scores = _mm256_add_ps(_mm256_mul_ps(weight, explore), _mm256_mul_ps(wins, inverse));
+        scores = _mm256_blendv_ps(_mm256_set1_ps(-INFINITY), scores, _mm256_castsi256_ps(valid));
+
+        // each lane keeps its first best child
+        __m256 better = _mm256_cmp_ps(scores, best_scores, _CMP_GT_OQ);
+        best_scores = _mm256_blendv_ps(best_scores, scores, better);
+        best_indices = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_indices), _mm256_castsi256_ps(indices), better));
+    }
+
+    // the best score over the lanes, then the lowest index holding it
+    __m256 max = _mm256_max_ps(best_scores, _mm256_permute2f128_ps(best_scores, best_scores, 1));
+    max = _mm256_max_ps(max, _mm256_shuffle_ps(max, max, _MM_SHUFFLE(1, 0, 3, 2)));
+    max = _mm256_max_ps(max, _mm256_shuffle_ps(max, max, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    __m256i holders = _mm256_castps_si256(_mm256_cmp_ps(best_scores, max, _CMP_EQ_OQ));
+    __m256i candidates = _mm256_blendv_epi8(_mm256_set1_epi32(PASS), best_indices, holders);
+    __m256i min = _mm256_min_epi32(candidates, _mm256_permute2x128_si256(candidates, candidates, 1));
+    min = _mm256_min_epi32(min, _mm256_shuffle_epi32(min, _MM_SHUFFLE(1, 0, 3, 2)));
+    min = _mm256_min_epi32(min, _mm256_shuffle_epi32(min, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm256_cvtsi256_si32(min);
+}
+
+// picks the child with the best UCT score, with the kernel of the
+// instruction set picked at startup by initCPU
+// bl -> the block to choose from, every child visited at least once
+// parent_log -> log of the parent's play count
+// returns -> index of the child
+static int (*selectChild)(block *bl, float parent_log) = selectChildScalar;
+
 // finds the successor leaf
 // tr -> the tree to find the leaf from
+// p -> filled with the statistics of every node from the root to the leaf
 // returns -> the successor leaf
-node *selectLeaf(tree *tr)
+node *selectLeaf(tree *tr, path *p)
 {
-    node *curr = tr->root;
+    node *curr = &tr->root;
+
+    p->length = 0;
+    pushPath(p, &tr->wins, &tr->plays);
 
     // while curr is not a leaf
+    block *bl;
     while (
-        curr->sim_count == curr->node_count && 
-        curr->sim_count != 0
+        (bl = __atomic_load_n(&curr->next, __ATOMIC_ACQUIRE)) &&
+        bl != EXPANDING &&
+        __atomic_load_n(&bl->sim_count, __ATOMIC_ACQUIRE) == bl->node_count
     )
     {
-        // selection algorithm
-        node *best_node = NULL;
-        double best_score;
-
-        for (int i = 0; i < curr->node_count; i++)
-        {
-            node *sub = curr->next[i];
-
-            // UCT with draw calculation included
-            double exploit = sub->wins / (double)sub->plays;
-            double explore = sqrt(log((double)curr->plays) / (double)sub->plays);
-            double score = exploit + 1.414*explore;
+        // the parent's log term is worked out once for all of its children
+        float parent_log = logf((float) __atomic_load_n(p->plays[p->length - 1], __ATOMIC_RELAXED));
+        int best_index = selectChild(bl, parent_log);
 
-            if (score > best_score || best_node == NULL)
-            {
-                best_node = sub;
-                best_score = score;
-            }
-        }
-        curr = best_node;
+        pushPath(p, &bl->wins[best_index], &bl->plays[best_index]);
+        curr = &bl->nodes[best_index];
     }
     return curr;
 }
 
 // selects a child node that hasn't yet been explored
+// tr -> the tree that owns the leaf
 // leaf -> the parent of the selected child node
-// returns -> the selected child node
-node *expandTree(node *leaf)
+// p -> the path to the leaf, extended with the selected child
+// r -> random number generator of the search
+// returns -> the selected child node, or the leaf itself if the game is over
+//            or another thread is busy with its children
+node *expandTree(tree *tr, node *leaf, path *p, rng *r)
 {
-    // populate node with child nodes
-    if (leaf->sim_count == 0)
+    // populate node with child nodes, only one thread may claim the leaf
+    block *expected = NULL;
+    if (__atomic_compare_exchange_n(&leaf->next, &expected, EXPANDING, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
     {
-        bitboard moves = getMoves(leaf->b);
-        leaf->node_count = __builtin_popcountll(moves);
-
-        // ensures that pass moves are accounted for
-        if (!leaf->node_count)
+        // the game is over when neither side can move, and the leaf is then
+        // evaluated directly
+        if (!leaf->b.moves && gameOver(&leaf->b))
         {
-            leaf->node_count = 1;
+            __atomic_store_n(&leaf->next, NULL, __ATOMIC_RELEASE);
+            return leaf;
         }
 
-        leaf->next = malloc(sizeof(node) * leaf->node_count);
+        // symmetric copies of early positions share their children
+        int sym;
+        bitboard key = positionKey(&leaf->b, &sym);
+
+        // share the children of a transposition if there is one
+        pthread_mutex_lock(&tr->lock);
+        block *bl = findBlock(tr, key, &leaf->b, sym);
+        if (bl)
+        {
+            bl->refs++;
+            tr->hits++;
+            tr->saved += blockSize(bl->node_count);
+        }
+        pthread_mutex_unlock(&tr->lock);
 
-        // adding moves
-        for (int i=0; i < leaf->node_count; i++)
+        if (!bl)
         {
-            bitboard ls1b = moves & -moves;
+            // room for a child per move, pass moves included, each child
+            // created the first time it is chosen
+            bitboard moves = childMoves(&leaf->b);
+            int node_count = moves ? __builtin_popcountll(moves) : 1;
+            bl = createBlock(tr, node_count, key);
+            bl->sym = sym;
+            addChildren(bl, &leaf->b);
+
+            // another thread may have stored the same position meanwhile
+            pthread_mutex_lock(&tr->lock);
+            block *other = findBlock(tr, bl->key, &leaf->b, sym);
+            if (other)
+            {
+                arenaFree(tr->arena, bl, blockSize(node_count));
+                bl = other;
+                bl->refs++;
+                tr->hits++;
+                tr->saved += blockSize(node_count);
+            }
+            else
+            {
+                storeBlock(tr, bl);
+                tr->stores++;
+            }
+            pthread_mutex_unlock(&tr->lock);
+        }
 
-            board *new_board = cloneBoard(leaf->b);
-            makeMove(new_board, ls1b);
-            leaf->next[i] = createNode(leaf, new_board, ls1b);
+        __atomic_store_n(&leaf->next, bl, __ATOMIC_RELEASE);
+    }
 
-            moves &= (moves - 1);
-        } 
+    block *bl = __atomic_load_n(&leaf->next, __ATOMIC_ACQUIRE);
+    if (!bl || bl == EXPANDING)
+    {
+        return leaf;
     }
 
-    // chooses a child node by randomly selecting a node until a node
-    // with no plays has been found
-    for (int i=0; i < 1000; i++)
+    // creates the child of a random untried move, claimed by taking the move
+    // out of the untried moves, and publishes it by its first play
+    bitboard untried = __atomic_load_n(&bl->untried, __ATOMIC_RELAXED);
+    while (untried)
     {
-        node *rand_node = leaf->next[rand() % leaf->node_count];
-        if (rand_node->plays == 0)
+        bitboard move = selectBit(untried, randomBelow(r, __builtin_popcountll(untried)));
+        if (__atomic_compare_exchange_n(&bl->untried, &untried, untried & ~move, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
         {
-            return rand_node;
-        }   
+            int index = createChild(bl, move);
+            __atomic_fetch_add(&tr->nodes, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&bl->plays[index], 1, __ATOMIC_RELEASE);
+            __atomic_fetch_add(&bl->sim_count, 1, __ATOMIC_RELEASE);
+
+            p->wins[p->length] = &bl->wins[index];
+            p->plays[p->length] = &bl->plays[index];
+            p->length++;
+
+            return &bl->nodes[index];
+        }
     }
 
-    // this should realistically never be printed
-    printf("no child found\n");
-    exit(1);
+    // every child was claimed by other threads in the meantime
+    return leaf;
 }
 
 // evaluates the child node 
-// done through standard random playouts
+// done through standard random playouts on a copy of the board kept on the stack
 // leaf -> the child node to start the playout from
-// returns -> the evaluation score
-double simulateTree(node *leaf)
+// r -> random number generator of the search
+// returns -> the discs of the side that moved to the child, from 0 to 64
+int simulateTree(node *leaf, rng *r)
 {
-    board *b = cloneBoard(leaf->b);
-    
-    // random moves until both players pass consecutively
-    int pass_count = 0;
-    while (pass_count < 2)
-    {
-        bitboard moves = b->moves;
-        int move_count = __builtin_popcountll(moves);
-
-        if (move_count == 0)
-        {
-            // pass
-            makeMove(b, 0x0);
-            pass_count++;
-        }
-        else
-        {
-            // pick random index - find and play that move
-            int index = rand() % move_count;
-            for (int i = 0; i < index; i++)
-            {
-                moves &= (moves - 1);
-            }
+    board b = leaf->b;
 
-            makeMove(b, moves & -moves);
-            pass_count = 0;
-        }
-    } 
+    // random moves until both players pass consecutively
+    playRandomGame(&b, r);
 
     // count pieces
-    bitboard pieces = b->pieces[!leaf->b->turn];
-    int count = __builtin_popcountll(pieces);
-
-    deleteBoard(b);
-
-    // determine winner
-    double score = (double)count / 64;
-    return score;
+    return __builtin_popcountll(b.pieces[!leaf->b.turn]);
 }
 
 // update the tree with the information from the simulation step
-// leaf -> the child node of the selected leaf
-// res -> the simulation function's score
-void backpropagateTree(node *leaf, double res)
+// plays were already counted on the way down, so only wins are added
+// p -> the nodes visited this round, from the root to the simulated node
+// res -> the simulation function's disc count
+void backpropagateTree(path *p, int res)
 {
-    // keep track of new simulations
-    if (leaf->plays == 0)
-    {
-        leaf->parent->sim_count++;
-    }
-
-    // propagation
-    node *curr = leaf;
-    while (curr != NULL)
+    // propagation, from the simulated node back up to the root
+    for (int i = p->length - 1; i >= 0; i--)
     {
         // count wins
-        curr->plays++;
-        curr->wins += res;
+        __atomic_fetch_add(p->wins[i], (uint64_t) res, __ATOMIC_RELAXED);
 
         // alternate up the tree
-        res = 1 - res;
-        curr = curr->parent;
+        res = 64 - res;
     }
 }
+
+// points the tree kernels at the variants of an instruction set level
+// level -> the level, which the cpu must support
+void useTreeKernels(isa level)
+{
+    // the vector loads of the statistics are not atomic, which the sanitizer
+    // reports although a stale count only makes the choice a little stale
+# ifdef __SANITIZE_THREAD__
+    selectChild = selectChildScalar;
+# else
+    selectChild = level >= avx2_isa ? selectChildAVX2 : selectChildScalar;
+# endif
+}
@@ -1,59 +1,193 @@
-# pragma GCC target("sse4") // popcnt instruction
+# ifndef TREE_H
+# define TREE_H
 
 # include <stdlib.h>
 # include <time.h>
 # include <string.h>
 # include <math.h>
+# include <pthread.h>
 # include "board.h"
+# include "arena.h"
+# include "rng.h"
+# include "stats.h"
+
+// share of the memory cap a pruned tree is brought back down to
+# define PRUNE_TARGET 0.75
+
+// positions with at most this many discs are keyed by their canonical hash,
+// so that their symmetric copies share one block, later positions being too
+// rarely symmetric to pay for hashing all eight copies
+# define SYMMETRY_DISCS 16
+
+// longest possible path from the root, 60 moves with a pass between each
+# define MAX_DEPTH 128
+
+// marks a node whose children are being created by another thread
+# define EXPANDING ((struct block *) 1)
+
+struct block;
 
 // store information for each node
-// next -> array of pointers to child nodes
-// parent -> pointer to parent node
-// wins -> number of wins found in that branch
-// plays -> number of times that node has been visited
+// next -> block holding the child nodes, NULL while the node is a leaf, or
+//         EXPANDING while a thread is creating them
+// b -> game state of the node
+// move -> the square played on the parent board to create the node, or PASS
 typedef struct node
 {
-    struct node *parent;
-    struct node **next;
+    struct block *next;
+    board b;
+    uint8_t move;
+} node;
+
+// the children of a node, kept in one contiguous allocation so that selection
+// only touches the statistics arrays and then the single chosen child
+// children are created one at a time, the first time each is chosen
+// wins -> discs won in each child's branch by the side that moved to the
+//         child, summed over its playouts, so that the counts stay exact
+// nodes -> the child nodes, the first child_count of them created
+// plays -> number of times each child has been visited
+// node_count -> number of children there is room for, one per move
+// sim_count -> number of children that have been visited
+// child_count -> number of children created
+// key -> hash of the position the children are created from, see positionKey
+// untried -> moves of that position with no child yet, a pass being held by
+//            any single bit
+// b -> that position, in the orientation of the children's moves
+// sym -> the symmetry positionKey gave that position
+// refs -> number of nodes whose children these are, as transpositions share
+//         one block between every node with the same position
+// mark -> the last pruning pass that visited the block
+typedef struct block
+{
+    uint64_t *wins;
+    node *nodes;
+    uint32_t *plays;
     int node_count;
     int sim_count;
-    double wins;
-    int plays;
-    board *b;
-    bitboard move;
-} node;
+    int child_count;
+    bitboard key;
+    bitboard untried;
+    board b;
+    int sym;
+    int refs;
+    int mark;
+} block;
+
+// transposition table entry
+// key -> hash of a position
+// bl -> the block holding that position's children
+typedef struct
+{
+    bitboard key;
+    block *bl;
+} entry;
 
 // tree structure
-// root -> pointer to head of tree
-// b -> the current state of the board to analyze
+// root -> head of tree
+// wins -> discs won under the root, summed over its playouts
+// plays -> number of times the root has been visited
+// sym -> the symmetry taking the root to the orientation of its block's moves,
+//        the one positionKey gives it unless later children were kept from a
+//        symmetric copy
+// arena -> owns the memory of every block in the tree
+// lock -> guards the arena and table when several threads search the tree
+// table -> transposition table, open addressed, from position hash to block
+// table_size -> number of slots in the table, a power of two
+// table_count -> number of entries in the table
+// hits -> expansions that found their position's block in the table
+// stores -> expansions that created a new block
+// saved -> bytes of blocks that were shared instead of created
+// nodes -> number of child nodes created over the life of the tree
+// limit -> bytes the tree may use before it is pruned, or 0 for no limit
+// rounds -> held for reading by searching threads, and for writing while
+//           the tree is pruned
+// pruning -> set while a thread waits to prune, holding back new rounds
+// pruned -> bytes freed by pruning
+// prunes -> number of times the tree was pruned
+// epoch -> number of pruning passes, marking the blocks each pass visits
 typedef struct
 {
-    node *root;
+    node root;
+    uint64_t wins;
+    uint32_t plays;
+    int sym;
+    arena *arena;
+    pthread_mutex_t lock;
+    entry *table;
+    size_t table_size;
+    size_t table_count;
+    uint64_t hits;
+    uint64_t stores;
+    size_t saved;
+    uint64_t nodes;
+    size_t limit;
+    pthread_rwlock_t rounds;
+    int pruning;
+    size_t pruned;
+    int prunes;
+    int epoch;
 } tree;
 
-node *createNode(node *parent, board *b, bitboard move);
+// nodes visited by one round, used to backpropagate without parent pointers
+// wins -> the disc count of each node on the path, starting at the root
+// plays -> the play count of each node on the path, starting at the root
+// length -> number of nodes on the path
+typedef struct
+{
+    uint64_t *wins[MAX_DEPTH + 1];
+    uint32_t *plays[MAX_DEPTH + 1];
+    int length;
+} path;
+
+size_t blockSize(int node_count);
+
+block *createBlock(tree *tr, int node_count, bitboard key);
+
+bitboard positionKey(board *b, int *sym);
+
+bitboard childMoves(board *b);
+
+void addChildren(block *bl, board *b);
+
+block *findBlock(tree *tr, bitboard key, board *b, int sym);
+
+void storeBlock(tree *tr, block *bl);
+
+void removeBlock(tree *tr, block *bl);
 
 tree *createTree(board *b);
 
 void deleteTree(tree *tr);
 
-void deleteNodes(node *node);
+void deleteNodes(tree *tr, node *node);
 
-void updateTree(tree *tr, bitboard move);
+void releaseNodes(tree *tr, block *bl);
+
+block *updateTree(tree *tr, bitboard move);
+
+square rootMove(tree *tr, block *bl, int i);
+
+size_t treeMemory(tree *tr);
+
+void pruneTree(tree *tr);
 
 void printTree(tree *tr);
 
-void printNodes(node *node, char *indent, int last, int depth);
+void printNodes(node *node, uint64_t wins, uint32_t plays, char *indent, int last, int depth);
 
 int getDepth(node *curr);
 
 // mtcs methods
-void doRound(tree *tr);
+void doRound(tree *tr, rng *r);
+
+node *selectLeaf(tree *tr, path *p);
+
+node *expandTree(tree *tr, node *leaf, path *p, rng *r);
 
-node *selectLeaf(tree *tr);
+int simulateTree(node *leaf, rng *r);
 
-node *expandTree(node *leaf);
+void backpropagateTree(path *p, int res);
 
-double simulateTree(node *leaf);
+void useTreeKernels(isa level);
 
-void backpropagateTree(node *leaf, double res);
+# endif
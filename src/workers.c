@@ -0,0 +1,252 @@
+# include <unistd.h>
+# include "workers.h"
+
+// number of tasks a queue starts with room for
+# define QUEUE_START 64
+
+// the pool and queue index of the calling thread, if it is a worker
+static __thread pool *current_pool = NULL;
+static __thread int current_worker = -1;
+
+// arguments of a worker thread
+// p -> the pool the worker belongs to
+// index -> the worker's queue
+typedef struct
+{
+    pool *p;
+    int index;
+} member;
+
+// adds a task to the back of a queue, growing it when full
+// q -> the queue
+// t -> the task
+static void pushTask(queue *q, task t)
+{
+    pthread_mutex_lock(&q->lock);
+    if (q->count == q->size)
+    {
+        task *tasks = (task *) malloc(2 * q->size * sizeof(task));
+        for (size_t i = 0; i < q->count; i++)
+        {
+            tasks[i] = q->tasks[(q->head + i) & (q->size - 1)];
+        }
+        free(q->tasks);
+        q->tasks = tasks;
+        q->head = 0;
+        q->size *= 2;
+    }
+
+    q->tasks[(q->head + q->count) & (q->size - 1)] = t;
+    q->count++;
+    pthread_mutex_unlock(&q->lock);
+}
+
+// takes a task from a queue
+// q -> the queue
+// back -> whether to take the newest task, as the owner does, or the oldest,
+//         as a thief does
+// t -> filled with the task
+// returns -> 1 if a task was taken, 0 if the queue was empty
+static int popTask(queue *q, int back, task *t)
+{
+    pthread_mutex_lock(&q->lock);
+    int found = q->count > 0;
+    if (found)
+    {
+        q->count--;
+        if (back)
+        {
+            *t = q->tasks[(q->head + q->count) & (q->size - 1)];
+        }
+        else
+        {
+            *t = q->tasks[q->head];
+            q->head = (q->head + 1) & (q->size - 1);
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return found;
+}
+
+// finds a task for a worker, first in its own queue and then by stealing
+// from the others, starting with its neighbour
+// p -> the pool
+// index -> the worker's queue
+// t -> filled with the task
+// returns -> 1 if a task was found
+static int findTask(pool *p, int index, task *t)
+{
+    if (popTask(&p->queues[index], 1, t))
+    {
+        return 1;
+    }
+
+    for (int i = 1; i < p->worker_count; i++)
+    {
+        if (popTask(&p->queues[(index + i) % p->worker_count], 0, t))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// runs tasks until the pool stops, sleeping while there are none
+// arg -> the worker's member struct
+// returns -> NULL
+static void *runWorker(void *arg)
+{
+    member *m = (member *) arg;
+    pool *p = m->p;
+    int index = m->index;
+    free(m);
+
+    current_pool = p;
+    current_worker = index;
+
+    while (1)
+    {
+        pthread_mutex_lock(&p->lock);
+        while (!p->queued && !p->stop)
+        {
+            pthread_cond_wait(&p->wake, &p->lock);
+        }
+        if (p->stop)
+        {
+            pthread_mutex_unlock(&p->lock);
+            break;
+        }
+        pthread_mutex_unlock(&p->lock);
+
+        // another worker may have taken the task first
+        task t;
+        if (!findTask(p, index, &t))
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&p->lock);
+        p->queued--;
+        pthread_mutex_unlock(&p->lock);
+
+        t.run(t.arg);
+
+        pthread_mutex_lock(&p->lock);
+        p->pending--;
+        pthread_cond_broadcast(&p->done);
+        pthread_mutex_unlock(&p->lock);
+    }
+
+    return NULL;
+}
+
+// creates a pool and starts its workers
+// worker_count -> number of worker threads
+// returns -> the new pool
+pool *createPool(int worker_count)
+{
+    pool *p = (pool *) malloc(sizeof(pool));
+    p->worker_count = worker_count;
+    p->next = 0;
+    p->queued = 0;
+    p->pending = 0;
+    p->stop = 0;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+    pthread_cond_init(&p->done, NULL);
+
+    p->queues = (queue *) malloc(sizeof(queue) * worker_count);
+    for (int i = 0; i < worker_count; i++)
+    {
+        queue *q = &p->queues[i];
+        q->tasks = (task *) malloc(QUEUE_START * sizeof(task));
+        q->head = 0;
+        q->count = 0;
+        q->size = QUEUE_START;
+        pthread_mutex_init(&q->lock, NULL);
+    }
+
+    p->ids = (pthread_t *) malloc(sizeof(pthread_t) * worker_count);
+    for (int i = 0; i < worker_count; i++)
+    {
+        member *m = (member *) malloc(sizeof(member));
+        m->p = p;
+        m->index = i;
+        pthread_create(&p->ids[i], NULL, runWorker, m);
+    }
+
+    return p;
+}
+
+// stops the workers once they finish their current tasks and deletes the
+// pool, dropping any tasks still queued
+// p -> the pool to delete
+void deletePool(pool *p)
+{
+    pthread_mutex_lock(&p->lock);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->worker_count; i++)
+    {
+        pthread_join(p->ids[i], NULL);
+    }
+
+    for (int i = 0; i < p->worker_count; i++)
+    {
+        free(p->queues[i].tasks);
+        pthread_mutex_destroy(&p->queues[i].lock);
+    }
+
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->wake);
+    pthread_cond_destroy(&p->done);
+    free(p->queues);
+    free(p->ids);
+    free(p);
+}
+
+// adds a task to the pool
+// a worker submitting a task keeps it in its own queue, and tasks from other
+// threads are spread over the queues in turn, idle workers stealing the rest
+// p -> the pool
+// t -> the task
+void submitTask(pool *p, task t)
+{
+    pthread_mutex_lock(&p->lock);
+    p->pending++;
+    int index = current_pool == p ? current_worker : p->next;
+    p->next = (p->next + 1) % p->worker_count;
+    pthread_mutex_unlock(&p->lock);
+
+    pushTask(&p->queues[index], t);
+
+    pthread_mutex_lock(&p->lock);
+    p->queued++;
+    pthread_cond_signal(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// waits until few enough submitted tasks are left unfinished
+// p -> the pool
+// limit -> number of unfinished tasks to wait for, 0 to wait for all of them
+void waitPool(pool *p, size_t limit)
+{
+    pthread_mutex_lock(&p->lock);
+    while (p->pending > limit)
+    {
+        pthread_cond_wait(&p->done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+// counts the cores available to the process
+// returns -> the number of online cores, at least one
+int countCores()
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int) cores : 1;
+}
@@ -0,0 +1,67 @@
+# ifndef WORKERS_H
+# define WORKERS_H
+
+# include <stdlib.h>
+# include <pthread.h>
+
+// a unit of work
+// run -> the function doing the work
+// arg -> the argument passed to it
+typedef struct
+{
+    void (*run)(void *arg);
+    void *arg;
+} task;
+
+// a worker's tasks, the worker takes from the back and thieves take from
+// the front
+// tasks -> ring buffer of tasks
+// head -> index of the first task
+// count -> number of tasks
+// size -> number of tasks there is room for, a power of two
+// lock -> guards the queue
+typedef struct
+{
+    task *tasks;
+    size_t head;
+    size_t count;
+    size_t size;
+    pthread_mutex_t lock;
+} queue;
+
+// work-stealing thread pool
+// queues -> one queue of tasks per worker
+// ids -> the worker threads
+// worker_count -> number of workers
+// next -> queue the next task from outside the pool goes to
+// queued -> number of tasks sitting in the queues
+// pending -> number of tasks submitted and not yet finished
+// lock -> guards next, queued, pending and stop
+// wake -> signaled when tasks are queued or the pool stops
+// done -> signaled whenever a task finishes
+// stop -> set to end the workers
+typedef struct
+{
+    queue *queues;
+    pthread_t *ids;
+    int worker_count;
+    int next;
+    size_t queued;
+    size_t pending;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int stop;
+} pool;
+
+pool *createPool(int worker_count);
+
+void deletePool(pool *p);
+
+void submitTask(pool *p, task t);
+
+void waitPool(pool *p, size_t limit);
+
+int countCores();
+
+# endif
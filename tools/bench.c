@@ -0,0 +1,201 @@
+# include <stdio.h>
+# include "ai.h"
+# include "clock.h"
+
+// playouts run from each position when timing simulateTree
+# define BENCH_PLAYOUTS 200000
+
+// rounds run on a fresh tree from each position when timing doRound
+# define BENCH_ROUNDS 200000
+
+// playouts budgeted for each move when timing calcBestMove
+# define BENCH_MOVE_PLAYOUTS 200000
+
+// seed of every random generator, so each run does the same work
+# define BENCH_SEED 1
+
+// a reference position
+// name -> label used in the results
+// pieces -> black and white pieces
+// turn -> the side to move
+// depth -> perft depth searched from the position
+// expected -> known perft count at that depth
+typedef struct
+{
+    const char *name;
+    bitboard pieces[2];
+    turn turn;
+    int depth;
+    uint64_t expected;
+} position;
+
+// the start position, then midgame positions reached by seeded random play
+static const position positions[] =
+{
+    { "start", { 0x0000000810000000ULL, 0x0000001008000000ULL }, black, 9, 3005288 },
+    { "ply20", { 0x0004287820600808ULL, 0x000102061E1E0000ULL }, black, 6, 2040644 },
+    { "ply32", { 0x0110387832790909ULL, 0x060707060C060400ULL }, black, 6, 653504 },
+    { "ply44", { 0x4F35131B1B031319ULL, 0x2002AC6424FC0C04ULL }, black, 5, 42330 },
+};
+
+# define POSITION_COUNT ((int) (sizeof(positions) / sizeof(position)))
+
+// counts the move sequences of a given length, a pass counting as a move and
+// a finished game as a single sequence
+// b -> the position to count from
+// depth -> the number of moves
+// returns -> the number of sequences
+static uint64_t perft(board *b, int depth)
+{
+    if (depth == 0 || gameOver(b))
+    {
+        return 1;
+    }
+
+    if (!b->moves)
+    {
+        board next = *b;
+        makeMove(&next, 0ULL);
+        return perft(&next, depth - 1);
+    }
+
+    uint64_t count = 0;
+    for (bitboard moves = b->moves; moves; moves &= moves - 1)
+    {
+        board next = *b;
+        makeMove(&next, moves & -moves);
+        count += perft(&next, depth - 1);
+    }
+
+    return count;
+}
+
+// builds the board of a reference position
+// pos -> the position
+// returns -> the board, with its moves and hash filled in
+static board loadPosition(const position *pos)
+{
+    board b = { .pieces = { pos->pieces[0], pos->pieces[1] }, .turn = pos->turn };
+    b.moves = getMoves(&b);
+    b.hash = hashBoard(&b);
+    return b;
+}
+
+// times move generation, playouts, search rounds and budgeted moves on every
+// reference position and prints the results as json
+// argc -> 1, or 2 with an instruction set to lower the kernels to
+// argv -> the program name, then the optional instruction set
+// returns -> 1 if a perft count differs from its known value, else 0
+int main(int argc, char *argv[])
+{
+    int failed = 0;
+
+    int level = argc > 1 ? parseISA(argv[1]) : isa_count - 1;
+    if (level < 0)
+    {
+        fprintf(stderr, "usage: %s [baseline|popcnt|bmi2|avx2]\n", argv[0]);
+        return 1;
+    }
+    initCPU(level);
+
+    printf("{\n  \"isa\": \"%s\",\n  \"perft\": [\n", isaName(cpu_isa));
+    for (int i = 0; i < POSITION_COUNT; i++)
+    {
+        const position *pos = &positions[i];
+        board b = loadPosition(pos);
+
+        double start = getClock();
+        uint64_t nodes = perft(&b, pos->depth);
+        double seconds = getClock() - start;
+
+        int ok = nodes == pos->expected;
+        failed |= !ok;
+
+        printf("    { \"position\": \"%s\", \"depth\": %d, \"nodes\": %llu, \"ok\": %s, \"seconds\": %.4f, \"nodes_per_sec\": %.0f }%s\n",
+            pos->name, pos->depth, (unsigned long long) nodes, ok ? "true" : "false",
+            seconds, nodes / seconds, i + 1 < POSITION_COUNT ? "," : "");
+    }
+
+    printf("  ],\n  \"playouts\": [\n");
+    for (int i = 0; i < POSITION_COUNT; i++)
+    {
+        const position *pos = &positions[i];
+        node leaf = { .next = NULL, .b = loadPosition(pos), .move = PASS };
+
+        rng r;
+        seedRandom(&r, BENCH_SEED);
+
+        // the mean result doubles as a check that the playouts are unchanged
+        double total = 0;
+        double start = getClock();
+        for (int n = 0; n < BENCH_PLAYOUTS; n++)
+        {
+            total += simulateTree(&leaf, &r);
+        }
+        double seconds = getClock() - start;
+
+        printf("    { \"position\": \"%s\", \"playouts\": %d, \"mean\": %.6f, \"seconds\": %.4f, \"playouts_per_sec\": %.0f }%s\n",
+            pos->name, BENCH_PLAYOUTS, total / BENCH_PLAYOUTS, seconds,
+            BENCH_PLAYOUTS / seconds, i + 1 < POSITION_COUNT ? "," : "");
+    }
+
+    printf("  ],\n  \"rounds\": [\n");
+    for (int i = 0; i < POSITION_COUNT; i++)
+    {
+        const position *pos = &positions[i];
+        board b = loadPosition(pos);
+        tree *tr = createTree(&b);
+
+        rng r;
+        seedRandom(&r, BENCH_SEED);
+
+        double start = getClock();
+        for (int n = 0; n < BENCH_ROUNDS; n++)
+        {
+            doRound(tr, &r);
+        }
+        double seconds = getClock() - start;
+
+        printf("    { \"position\": \"%s\", \"rounds\": %d, \"depth\": %d, \"memory\": %zu, \"seconds\": %.4f, \"rounds_per_sec\": %.0f }%s\n",
+            pos->name, BENCH_ROUNDS, getDepth(&tr->root), tr->arena->in_use, seconds,
+            BENCH_ROUNDS / seconds, i + 1 < POSITION_COUNT ? "," : "");
+
+        deleteTree(tr);
+    }
+
+    // a seeded budget picks the same move on every run, so only the time
+    // differs between builds
+    // a position with no real choice would be played without a search, so
+    // its one distinct move is made first and the reply is timed instead
+    printf("  ],\n  \"moves\": [\n");
+    for (int i = 0; i < POSITION_COUNT; i++)
+    {
+        const position *pos = &positions[i];
+        board b = loadPosition(pos);
+        char name[16];
+        strcpy(name, pos->name);
+        bitboard forced = childMoves(&b);
+        if (__builtin_popcountll(forced) == 1)
+        {
+            square played = bitMove(forced);
+            sprintf(name + strlen(name), "+%c%c", 'a' + played % 8, '1' + played / 8);
+            makeMove(&b, forced);
+        }
+
+        config cfg = { .seconds = 90, .playouts = BENCH_MOVE_PLAYOUTS, .threads = 1, .endgame = 0, .seed = BENCH_SEED };
+        AI *ai = createAI(&b, &cfg);
+
+        double start = getClock();
+        square sq = bitMove(calcBestMove(ai));
+        double seconds = getClock() - start;
+
+        printf("    { \"position\": \"%s\", \"playouts\": %u, \"move\": \"%c%c\", \"seconds\": %.4f, \"playouts_per_sec\": %.0f }%s\n",
+            name, ai->playouts, 'a' + sq % 8, '1' + sq / 8, seconds,
+            ai->playouts / seconds, i + 1 < POSITION_COUNT ? "," : "");
+
+        destroyAI(ai);
+    }
+    printf("  ]\n}\n");
+
+    return failed;
+}
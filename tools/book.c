@@ -0,0 +1,336 @@
+# include <stdio.h>
+# include <string.h>
+# include <unistd.h>
+# include "ai.h"
+
+// longest game transcript, 60 moves of two characters
+# define MAX_MOVES 60
+
+// one move played in a game, before the games are combined
+// key -> canonical hash of the position the move was played from
+// move -> the move in the canonical orientation
+// score -> final disc difference for the side that played the move
+typedef struct
+{
+    bitboard key;
+    uint8_t move;
+    int score;
+} sample;
+
+// samples gathered from every game
+// samples -> the samples
+// count -> number of samples
+// size -> number of samples there is room for
+typedef struct
+{
+    sample *samples;
+    size_t count;
+    size_t size;
+} samples;
+
+// adds the opening moves of a finished game to the samples
+// s -> the samples to add to
+// moves -> the squares played, passes left out
+// count -> number of moves
+// plies -> number of opening moves to add
+// returns -> 0 if the game was added, -1 if it is illegal or unfinished
+static int addGame(samples *s, uint8_t *moves, int count, int plies)
+{
+    board *b = createBoard();
+    size_t start = s->count;
+
+    for (int i = 0; i < count; i++)
+    {
+        // passes are not written in transcripts
+        if (!b->moves && !gameOver(b))
+        {
+            makeMove(b, 0ULL);
+        }
+
+        bitboard move = moveBit(moves[i]);
+        if (!(move & b->moves))
+        {
+            s->count = start;
+            deleteBoard(b);
+            return -1;
+        }
+
+        if (i < plies)
+        {
+            if (s->count == s->size)
+            {
+                s->size = s->size ? 2 * s->size : 4096;
+                s->samples = (sample *) realloc(s->samples, s->size * sizeof(sample));
+            }
+
+            int sym;
+            sample *sm = &s->samples[s->count++];
+            sm->key = canonicalHash(b, &sym);
+            sm->move = bitMove(transformBits(move, sym));
+
+            // the color of the mover, the score is filled in once the game ends
+            sm->score = b->turn;
+        }
+
+        makeMove(b, move);
+    }
+
+    if (!b->moves && !gameOver(b))
+    {
+        makeMove(b, 0ULL);
+    }
+    if (!gameOver(b))
+    {
+        s->count = start;
+        deleteBoard(b);
+        return -1;
+    }
+
+    int diff = __builtin_popcountll(b->pieces[black]) - __builtin_popcountll(b->pieces[white]);
+    for (size_t i = start; i < s->count; i++)
+    {
+        s->samples[i].score = s->samples[i].score == black ? diff : -diff;
+    }
+
+    deleteBoard(b);
+    return 0;
+}
+
+// reads a transcript such as "f5d6c3d3c4", one game per line
+// line -> the transcript
+// moves -> filled with the squares played
+// returns -> number of moves, or -1 if the line is not a transcript
+static int parseGame(const char *line, uint8_t *moves)
+{
+    int count = 0;
+    for (const char *c = line; *c; c++)
+    {
+        char file = *c | 0x20;
+        if (file >= 'a' && file <= 'h' && c[1] >= '1' && c[1] <= '8')
+        {
+            if (count == MAX_MOVES)
+            {
+                return -1;
+            }
+            moves[count++] = (c[1] - '1') * 8 + (file - 'a');
+            c++;
+        }
+        else if (*c != ' ' && *c != '\t' && *c != '\n' && *c != '\r')
+        {
+            return -1;
+        }
+    }
+    return count;
+}
+
+// plays a game between two ais, starting with a few random moves
+// cfg -> the settings of both ais
+// random_plies -> number of random moves to open with
+// seed -> seed of the random moves
+// moves -> filled with the squares played, passes left out
+// returns -> number of moves
+static int playGame(config *cfg, int random_plies, uint64_t seed, uint8_t *moves)
+{
+    rng r;
+    seedRandom(&r, seed);
+
+    board *b = createBoard();
+    int count = 0;
+
+    for (int i = 0; i < random_plies && b->moves; i++)
+    {
+        bitboard move = selectBit(b->moves, randomBelow(&r, __builtin_popcountll(b->moves)));
+        moves[count++] = bitMove(move);
+        makeMove(b, move);
+    }
+
+    AI *ais[2] = { createAI(b, cfg), createAI(b, cfg) };
+    while (!gameOver(b))
+    {
+        bitboard move = b->moves ? calcBestMove(ais[b->turn]) : 0ULL;
+        if (move)
+        {
+            moves[count++] = bitMove(move);
+        }
+
+        makeMove(b, move);
+        updateAI(ais[0], move);
+        updateAI(ais[1], move);
+    }
+
+    destroyAI(ais[0]);
+    destroyAI(ais[1]);
+    deleteBoard(b);
+    return count;
+}
+
+// orders samples by position, then by move
+// a -> the first sample
+// b -> the second sample
+// returns -> negative, zero or positive as for qsort
+static int compareSamples(const void *a, const void *b)
+{
+    const sample *x = (const sample *) a;
+    const sample *y = (const sample *) b;
+
+    if (x->key != y->key)
+    {
+        return x->key < y->key ? -1 : 1;
+    }
+    return (int) x->move - (int) y->move;
+}
+
+// combines the samples into one record per position, keeping the move with
+// the best mean score among those played often enough
+// s -> the samples, sorted
+// min_games -> number of games a move needs to be kept
+// records -> filled with the records, sorted by key
+// returns -> number of records
+static size_t buildRecords(samples *s, int min_games, record *records)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < s->count; )
+    {
+        bitboard key = s->samples[i].key;
+        record best = { .key = key, .move = PASS };
+        double best_score = 0;
+
+        while (i < s->count && s->samples[i].key == key)
+        {
+            uint8_t move = s->samples[i].move;
+            uint32_t games = 0;
+            double total = 0;
+            for (; i < s->count && s->samples[i].key == key && s->samples[i].move == move; i++)
+            {
+                games++;
+                total += s->samples[i].score;
+            }
+
+            double score = total / games;
+            if (games >= (uint32_t) min_games && (best.move == PASS || score > best_score || (score == best_score && games > best.games)))
+            {
+                best.move = move;
+                best.games = games;
+                best_score = score;
+            }
+        }
+
+        if (best.move != PASS)
+        {
+            best.score = (int8_t) (best_score < 0 ? best_score - 0.5 : best_score + 0.5);
+            records[count++] = best;
+        }
+    }
+
+    return count;
+}
+
+// builds an opening book from game transcripts read on stdin, or from games
+// the engine plays against itself, whose transcripts are then printed
+int main(int argc, char *argv[])
+{
+    int plies = 20;
+    int min_games = 2;
+    int games = 0;
+    int random_plies = 4;
+    config cfg = { .seconds = 4, .threads = 1, .shared = 0, .ponder = 0, .endgame = 20, .dump = NULL, .book = NULL, .snapshot = NULL };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:g:m:r:s:")) != -1)
+    {
+        switch (opt)
+        {
+            // number of opening moves of each game to keep
+            case 'd':
+                plies = atoi(optarg);
+                break;
+
+            // number of games to play against itself
+            case 'g':
+                games = atoi(optarg);
+                break;
+
+            // number of games a move needs to be kept
+            case 'm':
+                min_games = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+
+            // number of random moves each self-play game opens with
+            case 'r':
+                random_plies = atoi(optarg);
+                break;
+
+            // seconds each side gets for a self-play game
+            case 's':
+                cfg.seconds = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+
+            default:
+                optind = argc;
+                break;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-d plies] [-m games] [-g games [-r plies] [-s seconds]] book < transcripts\n", argv[0]);
+        return 1;
+    }
+
+    initCPU(isa_count - 1);
+
+    samples s = { NULL, 0, 0 };
+    uint8_t moves[MAX_MOVES];
+    int added = 0;
+    int skipped = 0;
+
+    if (games > 0)
+    {
+        for (int g = 0; g < games; g++)
+        {
+            int count = playGame(&cfg, random_plies, g, moves);
+            for (int i = 0; i < count; i++)
+            {
+                printf("%c%c", 'a' + moves[i] % 8, '1' + moves[i] / 8);
+            }
+            printf("\n");
+            fflush(stdout);
+
+            addGame(&s, moves, count, plies) == 0 ? added++ : skipped++;
+        }
+    }
+    else
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), stdin))
+        {
+            int count = parseGame(line, moves);
+            if (count > 0 && addGame(&s, moves, count, plies) == 0)
+            {
+                added++;
+            }
+            else if (count != 0)
+            {
+                skipped++;
+            }
+        }
+    }
+
+    qsort(s.samples, s.count, sizeof(sample), compareSamples);
+
+    record *records = (record *) malloc((s.count ? s.count : 1) * sizeof(record));
+    size_t count = buildRecords(&s, min_games, records);
+
+    if (writeBook(argv[optind], records, count) < 0)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    fprintf(stderr, "%i games added, %i skipped, %zu positions written\n", added, skipped, count);
+
+    free(records);
+    free(s.samples);
+    return 0;
+}
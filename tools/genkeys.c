@@ -0,0 +1,40 @@
+# include <stdio.h>
+
+// generates src/keys.h, the zobrist keys used to hash boards
+//
+// keys[color][sq] is xored into a hash for every piece on the board, and
+// turn_key when white is to move. the keys come from a fixed splitmix64
+// stream so hashes stay the same across builds and machines
+
+// gets the next value of a splitmix64 stream
+// state -> the stream state to advance
+// returns -> 64 random bits
+static unsigned long long nextKey(unsigned long long *state)
+{
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int main()
+{
+    unsigned long long state = 0x07E1107E1107E110ULL;
+
+    printf("// generated by tools/genkeys.c, do not edit\n\n");
+    printf("static const bitboard keys[2][64] =\n{\n");
+
+    for (int color = 0; color < 2; color++)
+    {
+        printf("    {\n");
+        for (int sq = 0; sq < 64; sq++)
+        {
+            printf("%s0x%016llxULL,%s", sq % 4 ? " " : "        ", nextKey(&state), sq % 4 == 3 ? "\n" : "");
+        }
+        printf("    },\n");
+    }
+
+    printf("};\n\n");
+    printf("static const bitboard turn_key = 0x%016llxULL;\n", nextKey(&state));
+    return 0;
+}
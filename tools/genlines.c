@@ -0,0 +1,44 @@
+# include <stdio.h>
+
+// generates src/lines.h, the per-square line masks used to compute flips
+//
+// lines[sq][d] holds every square after sq in direction d, up to the edge of
+// the board. the first 4 directions walk towards higher squares and the last 4
+// towards lower squares, which lets the flip kernel find the nearest square
+// that is not an opponent piece with a single bit scan
+
+// steps of each direction, as file and rank offsets
+// right, down, downright, downleft, left, up, upleft, upright
+static const int files[8] = { 1, 0, 1, -1, -1, 0, -1, 1 };
+static const int ranks[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+int main()
+{
+    printf("// generated by tools/genlines.c, do not edit\n\n");
+    printf("static const bitboard lines[64][8] =\n{\n");
+
+    for (int sq = 0; sq < 64; sq++)
+    {
+        printf("    {");
+        for (int d = 0; d < 8; d++)
+        {
+            unsigned long long line = 0ULL;
+            int file = sq % 8 + files[d];
+            int rank = sq / 8 + ranks[d];
+
+            // walk to the edge
+            while (file >= 0 && file < 8 && rank >= 0 && rank < 8)
+            {
+                line |= 1ULL << (rank * 8 + file);
+                file += files[d];
+                rank += ranks[d];
+            }
+
+            printf(" 0x%016llxULL%s", line, d < 7 ? "," : "");
+        }
+        printf(" },\n");
+    }
+
+    printf("};\n");
+    return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+# measures how search speed scales with the number of threads
+#
+# usage: tools/scaling.sh [seconds]
+# answers d3 as white at 1, 2, 4, 8 and 16 threads, once with a tree per
+# thread and once with a shared tree, and prints the playouts per second and
+# the depth of the principal line reached by each search
+# the first move of a game is not searched, as its four moves are symmetric
+# copies of one
+
+BOT=./othello-bot
+SECONDS_PER_GAME=${1:-60}
+
+printf "%-8s %-14s %14s %6s\n" threads mode playouts/s depth
+
+for mode in root shared
+do
+    flag=""
+    if [ "$mode" = shared ]
+    then
+        flag="-s"
+    fi
+
+    for threads in 1 2 4 8 16
+    do
+        out=$(printf "I W\nB d 3\n" | timeout $((SECONDS_PER_GAME / 30 + 2)) $BOT $flag -t $threads $SECONDS_PER_GAME 2>/dev/null)
+        speed=$(echo "$out" | grep -m1 "Speed:" | awk '{print $3}')
+        depth=$(echo "$out" | grep -m1 "Depth:" | awk '{print $3}')
+        printf "%-8s %-14s %14s %6s\n" $threads $mode "$speed" "$depth"
+    done
+done